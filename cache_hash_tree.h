@@ -0,0 +1,261 @@
+#ifndef BYTE_CACHEHASHTREE_H
+#define BYTE_CACHEHASHTREE_H
+
+#include "hash_tree.h"
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	struct cache_weigher
+	{
+		template<typename K, typename T>
+		size_t operator()(const K&, const T&) const
+		{
+			return sizeof(std::pair<const K, T>);
+		}
+	};
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t,
+		typename Weigher = cache_weigher>
+	class cache_hash_tree
+	{
+	private:
+		using tree_type = hash_tree<K, T, Hasher, Keyeq, Index>;
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+		using value_type = std::pair<const K, T>;
+		using const_iterator = typename tree_type::const_iterator;
+		using evict_callback = std::function<void(const K&, T&)>;
+
+	private:
+		tree_type _tree;
+		std::vector<unsigned char> _clock;
+		std::vector<size_t> _weights;
+		size_t _hand{ 0 };
+		size_t _weight{ 0 };
+		size_t _budget;
+		Weigher _weigher;
+		evict_callback _on_evict;
+
+	public:
+		explicit cache_hash_tree(size_t budget, const Weigher& weigher = {})
+			:_budget{ budget }, _weigher{ weigher }
+		{
+		}
+
+		void insert(const K& key, const T& value)
+		{
+			insert(key, T{ value });
+		}
+
+		void insert(const K& key, T&& value)
+		{
+			if (!replace(key, std::move(value)))
+			{
+				_tree.insert(key, std::move(value));
+				charge(_tree.index(key));
+			}
+		}
+
+		void insert(const K& key, const T& value, const K& parent)
+		{
+			insert(key, T{ value }, parent);
+		}
+
+		void insert(const K& key, T&& value, const K& parent)
+		{
+			if (!replace(key, std::move(value)))
+			{
+				_tree.insert(key, std::move(value), parent);
+				charge(_tree.index(key));
+			}
+		}
+
+		void erase(const K& key)
+		{
+			Index node_index{ _tree.index(key) };
+			if (node_index == tree_type::_EMPTY_INDEX)
+			{
+				return;
+			}
+
+			std::vector<Index> visit{ node_index };
+			for (size_t i{ 0 }; i < visit.size(); ++i)
+			{
+				_weight -= _weights[visit[i]];
+				for (Index child_index : std::as_const(_tree._nodes)[visit[i]].childs)
+				{
+					if (child_index != tree_type::_EMPTY_INDEX)
+					{
+						visit.push_back(child_index);
+					}
+				}
+			}
+
+			_tree._erase(node_index);
+		}
+
+		void set_parent(const K& key, const K& new_parent)
+		{
+			_tree.set_parent(key, new_parent);
+		}
+
+		void set_parent(const K& key, const K& new_parent, size_t position)
+		{
+			_tree.set_parent(key, new_parent, position);
+		}
+
+		T* find(const K& key)
+		{
+			Index _index{ _tree.index(key) };
+			if (_index == tree_type::_EMPTY_INDEX)
+			{
+				return nullptr;
+			}
+
+			_clock[_index] = 1;
+			return &_tree._nodes[_index].pair.second;
+		}
+
+		T& at(const K& key)
+		{
+			return *find(key);
+		}
+
+		bool contains(const K& key)
+		{
+			return find(key) != nullptr;
+		}
+
+		const_iterator begin() const
+		{
+			return std::as_const(_tree).begin();
+		}
+
+		const_iterator end() const
+		{
+			return std::as_const(_tree).end();
+		}
+
+		size_t size() const
+		{
+			return _tree.size();
+		}
+
+		size_t weight() const
+		{
+			return _weight;
+		}
+
+		size_t budget() const
+		{
+			return _budget;
+		}
+
+		void set_budget(size_t budget)
+		{
+			_budget = budget;
+			evict();
+		}
+
+		void on_evict(evict_callback callback)
+		{
+			_on_evict = std::move(callback);
+		}
+
+		void clear()
+		{
+			_tree.clear();
+			_clock.clear();
+			_weights.clear();
+			_hand = 0;
+			_weight = 0;
+		}
+
+		const tree_type& tree() const
+		{
+			return _tree;
+		}
+
+	private:
+		bool replace(const K& key, T&& value)
+		{
+			Index node_index{ _tree.index(key) };
+			if (node_index == tree_type::_EMPTY_INDEX)
+			{
+				return false;
+			}
+
+			_tree._nodes[node_index].pair.second = std::move(value);
+			_weight -= _weights[node_index];
+			charge(node_index);
+			return true;
+		}
+
+		void charge(Index node_index)
+		{
+			if (node_index >= _clock.size())
+			{
+				_clock.resize(_tree._nodes.capacity());
+				_weights.resize(_tree._nodes.capacity());
+			}
+
+			const value_type& pair{ std::as_const(_tree._nodes)[node_index].pair };
+			_weights[node_index] = _weigher(pair.first, pair.second);
+			_clock[node_index] = 0;
+			_weight += _weights[node_index];
+
+			evict();
+		}
+
+		void evict()
+		{
+			while (_weight > _budget && _tree.size() != 0)
+			{
+				if (_hand >= _tree._nodes.capacity())
+				{
+					_hand = 0;
+				}
+
+				if (!_tree._nodes.test(_hand) || !std::as_const(_tree._nodes)[_hand].childs.empty())
+				{
+					++_hand;
+					continue;
+				}
+
+				if (_clock[_hand])
+				{
+					_clock[_hand] = 0;
+					++_hand;
+					continue;
+				}
+
+				auto& node{ _tree._nodes[_hand] };
+				if (_on_evict)
+				{
+					_on_evict(node.pair.first, node.pair.second);
+				}
+
+				_weight -= _weights[_hand];
+				_tree._erase(static_cast<Index>(_hand));
+				++_hand;
+			}
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,408 @@
+#ifndef BYTE_COWSPARSEVECTOR_H
+#define BYTE_COWSPARSEVECTOR_H
+
+#include "sparse_vector.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <bitset>
+#include <memory>
+#include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	template<typename T>
+	class cow_page
+	{
+	private:
+		using bitset64 = std::bitset<_BITSET_SIZE>;
+
+		struct alignas(T) storage
+		{
+			unsigned char bytes[sizeof(T)];
+		};
+
+	public:
+		bitset64 bits;
+
+	private:
+		std::array<storage, _BITSET_SIZE> _slots;
+
+	public:
+		cow_page() = default;
+
+		cow_page(const cow_page& left)
+			:bits{ left.bits }
+		{
+			for (size_t index{ 0 }; index < _BITSET_SIZE; ++index)
+			{
+				if (bits.test(index))
+				{
+					::new (&_slots[index]) T{ left[index] };
+				}
+			}
+		}
+
+		cow_page& operator=(const cow_page& left) = delete;
+
+		~cow_page()
+		{
+			if (!std::is_trivially_destructible<T>::value)
+			{
+				for (size_t index{ 0 }; index < _BITSET_SIZE; ++index)
+				{
+					if (bits.test(index))
+					{
+						(*this)[index].~T();
+					}
+				}
+			}
+		}
+
+		T& operator[](size_t index)
+		{
+			return *std::launder(reinterpret_cast<T*>(&_slots[index]));
+		}
+
+		const T& operator[](size_t index) const
+		{
+			return *std::launder(reinterpret_cast<const T*>(&_slots[index]));
+		}
+
+		template<class... Args>
+		void construct(size_t index, Args&&... args)
+		{
+			std::construct_at(reinterpret_cast<T*>(&_slots[index]), std::forward<Args>(args)...);
+			bits.set(index);
+		}
+
+		void destroy(size_t index)
+		{
+			(*this)[index].~T();
+			bits.reset(index);
+		}
+	};
+
+	template<typename Vector, typename T>
+	class cow_sparse_vector_iterator
+	{
+	private:
+		using vector_ptr = std::conditional_t<std::is_const<T>::value, const Vector*, Vector*>;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T*;
+		using reference = value_type&;
+
+	private:
+		vector_ptr _vector;
+		size_t _index;
+
+	public:
+		cow_sparse_vector_iterator(vector_ptr vector, size_t index)
+			:_vector{ vector }, _index{ index }
+		{
+			if (_index < _vector->end_index() && !_vector->test(_index))
+			{
+				++(*this);
+			}
+		}
+
+		reference operator*() const
+		{
+			return (*_vector)[_index];
+		}
+
+		pointer operator->() const
+		{
+			return &(*_vector)[_index];
+		}
+
+		cow_sparse_vector_iterator& operator++()
+		{
+			_index = _vector->next_index(_index + 1);
+			return *this;
+		}
+
+		cow_sparse_vector_iterator operator++(int)
+		{
+			cow_sparse_vector_iterator out{ *this };
+			++(*this);
+			return out;
+		}
+
+		bool operator==(const cow_sparse_vector_iterator& left) const
+		{
+			return _index == left._index;
+		}
+
+		bool operator!=(const cow_sparse_vector_iterator& left) const
+		{
+			return _index != left._index;
+		}
+
+		size_t index() const
+		{
+			return _index;
+		}
+	};
+
+	template<typename T>
+	class cow_sparse_vector
+	{
+	private:
+		using page_type = cow_page<T>;
+		using page_ptr = std::shared_ptr<page_type>;
+		using page_container = std::vector<page_ptr>;
+		using index_set = std::set<size_t>;
+
+	public:
+		using value_type = T;
+		using allocator_type = std::allocator<T>;
+		using pointer = T*;
+		using const_pointer = const T*;
+		using reference = T&;
+		using const_reference = const T&;
+		using size_type = size_t;
+		using difference_type = std::ptrdiff_t;
+		using iterator = cow_sparse_vector_iterator<cow_sparse_vector, T>;
+		using const_iterator = cow_sparse_vector_iterator<cow_sparse_vector, const T>;
+
+	private:
+		page_container _pages;
+		index_set indices;
+		size_t _size{ 0 };
+
+	public:
+		template<class... Args>
+		[[maybe_unused]] size_t emplace(Args&&... args)
+		{
+			if (indices.empty())
+			{
+				indices.insert(_pages.size());
+				_pages.push_back(std::make_shared<page_type>());
+			}
+
+			size_t page_index{ *indices.begin() };
+			page_type& page{ writable(page_index) };
+			size_t bit_index{ static_cast<size_t>(std::countr_one(page.bits.to_ullong())) };
+
+			page.construct(bit_index, std::forward<Args>(args)...);
+			if (page.bits.all())
+			{
+				indices.erase(page_index);
+			}
+
+			++_size;
+			return page_index * _BITSET_SIZE + bit_index;
+		}
+
+		void erase(size_t index)
+		{
+			size_t page_index{ index / _BITSET_SIZE };
+			writable(page_index).destroy(index % _BITSET_SIZE);
+			indices.insert(page_index);
+			--_size;
+		}
+
+		reference at(size_t index)
+		{
+			return writable(index / _BITSET_SIZE)[index % _BITSET_SIZE];
+		}
+
+		const_reference at(size_t index) const
+		{
+			return (*_pages[index / _BITSET_SIZE])[index % _BITSET_SIZE];
+		}
+
+		reference operator[](size_t index)
+		{
+			return at(index);
+		}
+
+		const_reference operator[](size_t index) const
+		{
+			return at(index);
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+
+		bool empty() const
+		{
+			return _size == 0;
+		}
+
+		size_t capacity() const
+		{
+			return end_index();
+		}
+
+		void clear()
+		{
+			_pages.clear();
+			indices.clear();
+			_size = 0;
+		}
+
+		void reserve(size_t new_capacity)
+		{
+			while (capacity() < new_capacity)
+			{
+				indices.insert(_pages.size());
+				_pages.push_back(std::make_shared<page_type>());
+			}
+		}
+
+		void shrink_to_fit()
+		{
+			while (!_pages.empty() && _pages.back()->bits.none())
+			{
+				indices.erase(_pages.size() - 1);
+				_pages.pop_back();
+			}
+			_pages.shrink_to_fit();
+		}
+
+		iterator begin()
+		{
+			return iterator{ this, 0 };
+		}
+
+		iterator end()
+		{
+			return iterator{ this, end_index() };
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator{ this, 0 };
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator{ this, end_index() };
+		}
+
+		bool test(size_t index) const
+		{
+			return _pages[index / _BITSET_SIZE]->bits.test(index % _BITSET_SIZE);
+		}
+
+		size_t end_index() const
+		{
+			return _pages.size() * _BITSET_SIZE;
+		}
+
+		size_t next_index(size_t index) const
+		{
+			for (size_t page_index{ index / _BITSET_SIZE }; page_index < _pages.size(); ++page_index)
+			{
+				size_t bit_index{ index % _BITSET_SIZE };
+				size_t bits{ _pages[page_index]->bits.to_ullong() >> bit_index };
+				if (bits != 0)
+				{
+					return index + static_cast<size_t>(std::countr_zero(bits));
+				}
+				index += _BITSET_SIZE - bit_index;
+			}
+
+			return end_index();
+		}
+
+		bool shared(size_t index) const
+		{
+			return _pages[index / _BITSET_SIZE].use_count() != 1;
+		}
+
+	private:
+		page_type& writable(size_t page_index)
+		{
+			page_ptr& page{ _pages[page_index] };
+			if (page.use_count() != 1)
+			{
+				page = std::make_shared<page_type>(*page);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			return *page;
+		}
+	};
+
+	template<typename T, size_t PageSize = 512>
+	class cow_vector
+	{
+	private:
+		using page_type = std::array<T, PageSize>;
+		using page_ptr = std::shared_ptr<page_type>;
+
+	public:
+		using value_type = T;
+		using reference = T&;
+		using const_reference = const T&;
+
+	private:
+		std::vector<page_ptr> _pages;
+		size_t _size{ 0 };
+
+	public:
+		cow_vector() = default;
+
+		cow_vector(size_t count, const T& value)
+		{
+			assign(count, value);
+		}
+
+		void assign(size_t count, const T& value)
+		{
+			_pages.clear();
+			_pages.reserve((count + PageSize - 1) / PageSize);
+			for (size_t page_index{ 0 }; page_index * PageSize < count; ++page_index)
+			{
+				page_ptr page{ std::make_shared<page_type>() };
+				page->fill(value);
+				_pages.push_back(std::move(page));
+			}
+			_size = count;
+		}
+
+		void shrink_to_fit()
+		{
+			_pages.shrink_to_fit();
+		}
+
+		reference operator[](size_t index)
+		{
+			page_ptr& page{ _pages[index / PageSize] };
+			if (page.use_count() != 1)
+			{
+				page = std::make_shared<page_type>(*page);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			return (*page)[index % PageSize];
+		}
+
+		const_reference operator[](size_t index) const
+		{
+			return (*_pages[index / PageSize])[index % PageSize];
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+	};
+
+}
+
+#endif
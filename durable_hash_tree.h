@@ -0,0 +1,468 @@
+#ifndef BYTE_DURABLEHASHTREE_H
+#define BYTE_DURABLEHASHTREE_H
+
+#include "hash_tree.h"
+
+#ifdef BYTE_HAS_FD_STREAMBUF
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace Byte
+{
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename KeyCodec = codec<K>,
+		typename ValueCodec = codec<T>>
+	class durable_hash_tree
+	{
+	private:
+		using tree_type = hash_tree<K, T, Hasher, Keyeq>;
+		using log_type = typename tree_type::log_type;
+
+		inline static constexpr size_t CHUNK_HEADER{ sizeof(uint64_t) + sizeof(uint32_t) };
+
+	public:
+		using key_type = K;
+		using mapped_type = T;
+		using value_type = typename tree_type::value_type;
+		using const_iterator = typename tree_type::const_iterator;
+		using transaction = typename tree_type::transaction;
+
+	private:
+		tree_type _tree;
+		log_type _log;
+		std::string _path;
+		int _wal_fd{ -1 };
+		size_t _group_size;
+		size_t _checkpoint_interval;
+		log_sequence _checkpoint_sequence{ 0 };
+		KeyCodec _key_codec;
+		ValueCodec _value_codec;
+
+	public:
+		explicit durable_hash_tree(
+			std::string path,
+			size_t group_size = 256,
+			size_t checkpoint_interval = 0,
+			const KeyCodec& key_codec = {},
+			const ValueCodec& value_codec = {})
+			:_path{ std::move(path) },
+			_group_size{ group_size },
+			_checkpoint_interval{ checkpoint_interval },
+			_key_codec{ key_codec },
+			_value_codec{ value_codec }
+		{
+			off_t wal_size{ recover() };
+
+			_wal_fd = ::open(wal_path().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+			if (_wal_fd < 0 || ::ftruncate(_wal_fd, wal_size) != 0)
+			{
+				close_wal();
+				throw std::runtime_error{ "durable_hash_tree: cannot open write-ahead log" };
+			}
+
+			_tree.attach_log(&_log);
+		}
+
+		durable_hash_tree(const durable_hash_tree& left) = delete;
+
+		durable_hash_tree& operator=(const durable_hash_tree& left) = delete;
+
+		~durable_hash_tree()
+		{
+			try
+			{
+				sync();
+			}
+			catch (...)
+			{
+			}
+			close_wal();
+		}
+
+		void insert(const K& key, const T& value)
+		{
+			_tree.insert(key, value);
+			group_commit();
+		}
+
+		void insert(K&& key, T&& value)
+		{
+			_tree.insert(std::move(key), std::move(value));
+			group_commit();
+		}
+
+		void insert(const K& key, const T& value, const K& parent)
+		{
+			_tree.insert(key, value, parent);
+			group_commit();
+		}
+
+		void insert(K&& key, T&& value, const K& parent)
+		{
+			_tree.insert(std::move(key), std::move(value), parent);
+			group_commit();
+		}
+
+		void erase(const K& key)
+		{
+			_tree.erase(key);
+			group_commit();
+		}
+
+		void set_parent(const K& key, const K& new_parent)
+		{
+			_tree.set_parent(key, new_parent);
+			group_commit();
+		}
+
+		void set_parent(const K& key, const K& new_parent, size_t position)
+		{
+			_tree.set_parent(key, new_parent, position);
+			group_commit();
+		}
+
+		void assign(const K& key, const T& value)
+		{
+			_tree.assign(key, value);
+			group_commit();
+		}
+
+		void assign(const K& key, T&& value)
+		{
+			_tree.assign(key, std::move(value));
+			group_commit();
+		}
+
+		void clear()
+		{
+			_tree.clear();
+			group_commit();
+		}
+
+		transaction begin_transaction()
+		{
+			return _tree.begin_transaction();
+		}
+
+		void commit(transaction& pending)
+		{
+			pending.commit();
+			group_commit();
+		}
+
+		const T& at(const K& key) const
+		{
+			return _tree.at(key);
+		}
+
+		const T& operator[](const K& key) const
+		{
+			return _tree.at(key);
+		}
+
+		bool contains(const K& key) const
+		{
+			return _tree.contains(key);
+		}
+
+		size_t size() const
+		{
+			return _tree.size();
+		}
+
+		const_iterator begin() const
+		{
+			return _tree.begin();
+		}
+
+		const_iterator end() const
+		{
+			return _tree.end();
+		}
+
+		const tree_type& tree() const
+		{
+			return _tree;
+		}
+
+		void sync()
+		{
+			if (_log.empty())
+			{
+				return;
+			}
+
+			std::ostringstream chunk;
+			_log.write(chunk, _log.first_sequence(), _key_codec, _value_codec);
+
+			std::string payload{ chunk.str() };
+			uint64_t length{ payload.size() };
+			uint32_t checksum{ crc32(payload) };
+
+			std::string bytes(CHUNK_HEADER, '\0');
+			std::memcpy(bytes.data(), &length, sizeof(uint64_t));
+			std::memcpy(bytes.data() + sizeof(uint64_t), &checksum, sizeof(uint32_t));
+			bytes += payload;
+
+			if (!write_all(_wal_fd, bytes) || ::fsync(_wal_fd) != 0)
+			{
+				throw std::runtime_error{ "durable_hash_tree: write-ahead log sync failed" };
+			}
+
+			_log.clear();
+		}
+
+		void checkpoint()
+		{
+			sync();
+
+			std::string temp_path{ checkpoint_path() + ".tmp" };
+			int fd{ ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+			if (fd < 0)
+			{
+				throw std::runtime_error{ "durable_hash_tree: cannot create checkpoint" };
+			}
+
+			bool written{ false };
+			{
+				fd_streambuf<> buffer{ fd };
+				std::ostream out{ &buffer };
+				write_varint(out, _log.next_sequence());
+				_tree.save(out, _key_codec, _value_codec);
+				out.flush();
+				written = static_cast<bool>(out);
+			}
+
+			written = ::fsync(fd) == 0 && written;
+			::close(fd);
+
+			if (!written || std::rename(temp_path.c_str(), checkpoint_path().c_str()) != 0)
+			{
+				std::remove(temp_path.c_str());
+				throw std::runtime_error{ "durable_hash_tree: checkpoint failed" };
+			}
+
+			sync_directory();
+			_checkpoint_sequence = _log.next_sequence();
+
+			if (::ftruncate(_wal_fd, 0) != 0)
+			{
+				throw std::runtime_error{ "durable_hash_tree: cannot truncate write-ahead log" };
+			}
+		}
+
+	private:
+		std::string checkpoint_path() const
+		{
+			return _path + ".checkpoint";
+		}
+
+		std::string wal_path() const
+		{
+			return _path + ".wal";
+		}
+
+		void group_commit()
+		{
+			if (_log.size() >= _group_size)
+			{
+				sync();
+			}
+
+			if (_checkpoint_interval && _log.next_sequence() - _checkpoint_sequence >= _checkpoint_interval)
+			{
+				checkpoint();
+			}
+		}
+
+		off_t recover()
+		{
+			log_sequence sequence{ 0 };
+
+			int fd{ ::open(checkpoint_path().c_str(), O_RDONLY) };
+			if (fd >= 0)
+			{
+				bool loaded{ false };
+				try
+				{
+					fd_streambuf<> buffer{ fd };
+					std::istream in{ &buffer };
+					sequence = read_varint(in);
+					_tree.load(in, _key_codec, _value_codec);
+					loaded = static_cast<bool>(in);
+				}
+				catch (...)
+				{
+					::close(fd);
+					throw;
+				}
+				::close(fd);
+
+				if (!loaded)
+				{
+					throw std::runtime_error{ "durable_hash_tree: corrupt checkpoint" };
+				}
+			}
+			_checkpoint_sequence = sequence;
+
+			off_t wal_size{ 0 };
+			fd = ::open(wal_path().c_str(), O_RDONLY);
+			if (fd >= 0)
+			{
+				try
+				{
+					wal_size = replay(fd, sequence);
+				}
+				catch (...)
+				{
+					::close(fd);
+					throw;
+				}
+				::close(fd);
+			}
+
+			_log.restart(sequence);
+			return wal_size;
+		}
+
+		off_t replay(int fd, log_sequence& sequence)
+		{
+			struct stat status{};
+			if (::fstat(fd, &status) != 0)
+			{
+				throw std::runtime_error{ "durable_hash_tree: cannot read write-ahead log" };
+			}
+
+			fd_streambuf<> buffer{ fd };
+			std::istream in{ &buffer };
+			off_t wal_size{ 0 };
+			while (static_cast<uint64_t>(status.st_size - wal_size) >= CHUNK_HEADER)
+			{
+				uint64_t length{ 0 };
+				uint32_t checksum{ 0 };
+				in.read(reinterpret_cast<char*>(&length), sizeof(uint64_t));
+				in.read(reinterpret_cast<char*>(&checksum), sizeof(uint32_t));
+				if (!in || length > static_cast<uint64_t>(status.st_size - wal_size) - CHUNK_HEADER)
+				{
+					break;
+				}
+
+				std::string bytes(length, '\0');
+				in.read(bytes.data(), bytes.size());
+				if (!in || crc32(bytes) != checksum)
+				{
+					break;
+				}
+
+				std::istringstream chunk{ std::move(bytes) };
+				log_type records;
+				records.read(chunk, _key_codec, _value_codec);
+				if (!chunk)
+				{
+					break;
+				}
+
+				if (records.first_sequence() > sequence)
+				{
+					throw std::runtime_error{ "durable_hash_tree: write-ahead log has a gap" };
+				}
+
+				if (records.next_sequence() > sequence)
+				{
+					_tree.apply_log(records, sequence);
+				}
+				wal_size += static_cast<off_t>(CHUNK_HEADER + length);
+			}
+
+			return wal_size;
+		}
+
+		void sync_directory() const
+		{
+			size_t slash{ _path.find_last_of('/') };
+			std::string directory{ slash == std::string::npos ? "." : slash == 0 ? "/" : _path.substr(0, slash) };
+
+			int fd{ ::open(directory.c_str(), O_RDONLY) };
+			if (fd >= 0)
+			{
+				::fsync(fd);
+				::close(fd);
+			}
+		}
+
+		void close_wal()
+		{
+			if (_wal_fd >= 0)
+			{
+				::close(_wal_fd);
+				_wal_fd = -1;
+			}
+		}
+
+		static uint32_t crc32(const std::string& bytes)
+		{
+			static const std::array<uint32_t, 256> table{ []
+				{
+					std::array<uint32_t, 256> out{};
+					for (uint32_t i{ 0 }; i < 256; ++i)
+					{
+						uint32_t value{ i };
+						for (size_t bit{ 0 }; bit < 8; ++bit)
+						{
+							value = value & 1 ? 0xEDB88320U ^ (value >> 1) : value >> 1;
+						}
+						out[i] = value;
+					}
+					return out;
+				}() };
+
+			uint32_t value{ 0xFFFFFFFFU };
+			for (char byte : bytes)
+			{
+				value = table[(value ^ static_cast<unsigned char>(byte)) & 0xFF] ^ (value >> 8);
+			}
+
+			return ~value;
+		}
+
+		static bool write_all(int fd, const std::string& bytes)
+		{
+			const char* it{ bytes.data() };
+			const char* end{ bytes.data() + bytes.size() };
+			while (it < end)
+			{
+				ssize_t count{ ::write(fd, it, end - it) };
+				if (count <= 0)
+				{
+					return false;
+				}
+				it += count;
+			}
+
+			return true;
+		}
+	};
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef BYTE_FROZENHASHTREE_H
+#define BYTE_FROZENHASHTREE_H
+
+#include "hash_tree_hash.h"
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstdint>
+#include <stdexcept>
+
+namespace Byte
+{
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t>
+	class frozen_hash_tree
+	{
+	private:
+		inline static constexpr Index EMPTY{ std::numeric_limits<Index>::max() };
+		inline static constexpr size_t BUCKET_SIZE{ 4 };
+		inline static constexpr uint32_t MAX_DISPLACEMENT{ 1U << 20 };
+		inline static constexpr size_t MAX_RESIZES{ 64 };
+
+		using key_container = std::vector<K>;
+		using value_container = std::vector<T>;
+		using index_container = std::vector<Index>;
+		using displacement_container = std::vector<uint32_t>;
+
+		template<typename, typename, typename, typename, typename, typename, typename>
+		friend class shm_hash_tree;
+
+		template<typename, typename, typename, typename, typename, typename>
+		friend class paged_hash_tree;
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+		using index_type = Index;
+
+		using iterator = typename value_container::const_iterator;
+		using const_iterator = typename value_container::const_iterator;
+
+	private:
+		key_container _keys;
+		value_container _values;
+		index_container _parents;
+		index_container _child_offsets{ 0 };
+		index_container _childs;
+		displacement_container _displacements;
+		index_container _slots;
+		Hasher _hasher;
+		Keyeq _keyeq;
+
+	public:
+		frozen_hash_tree() = default;
+
+		frozen_hash_tree(
+			key_container&& keys,
+			value_container&& values,
+			index_container&& parents,
+			const Hasher& hasher = {},
+			const Keyeq& keyeq = {})
+			:_keys{ std::move(keys) },
+			_values{ std::move(values) },
+			_parents{ std::move(parents) },
+			_hasher{ hasher },
+			_keyeq{ keyeq }
+		{
+			build_childs();
+			build_slots();
+		}
+
+		const T& at(const K& key) const
+		{
+			return _values[index(key)];
+		}
+
+		const T& operator[](const K& key) const
+		{
+			return at(key);
+		}
+
+		bool contains(const K& key) const
+		{
+			return index(key) != EMPTY;
+		}
+
+		size_t child_count(const K& key) const
+		{
+			Index position{ index(key) };
+			return _child_offsets[position + 1] - _child_offsets[position];
+		}
+
+		template<typename Function>
+		void for_each_child(const K& key, Function&& function) const
+		{
+			Index position{ index(key) };
+			for (Index i{ _child_offsets[position] }; i < _child_offsets[position + 1]; ++i)
+			{
+				function(_keys[_childs[i]], _values[_childs[i]]);
+			}
+		}
+
+		const_iterator begin() const
+		{
+			return _values.begin();
+		}
+
+		const_iterator end() const
+		{
+			return _values.end();
+		}
+
+		size_t size() const
+		{
+			return _keys.size();
+		}
+
+		bool empty() const
+		{
+			return _keys.empty();
+		}
+
+		size_t table_size() const
+		{
+			return _slots.size();
+		}
+
+	private:
+		Index index(const K& key) const
+		{
+			if (_slots.empty())
+			{
+				return EMPTY;
+			}
+
+			size_t hash_value{ _hasher(key) };
+			uint32_t displacement{ _displacements[hash_value % _displacements.size()] };
+			Index position{ _slots[_mix_hash(hash_value, displacement) % _slots.size()] };
+
+			if (position != EMPTY && _keyeq(_keys[position], key))
+			{
+				return position;
+			}
+
+			return EMPTY;
+		}
+
+		void build_childs()
+		{
+			_child_offsets.assign(size() + 1, 0);
+			for (Index parent : _parents)
+			{
+				if (parent != EMPTY)
+				{
+					++_child_offsets[parent + 1];
+				}
+			}
+			std::partial_sum(_child_offsets.begin(), _child_offsets.end(), _child_offsets.begin());
+
+			index_container cursor(_child_offsets.begin(), _child_offsets.end() - 1);
+			_childs.resize(_child_offsets.back());
+			for (Index position{ 0 }; position < size(); ++position)
+			{
+				if (_parents[position] != EMPTY)
+				{
+					_childs[cursor[_parents[position]]++] = position;
+				}
+			}
+		}
+
+		void build_slots()
+		{
+			if (empty())
+			{
+				return;
+			}
+
+			std::vector<size_t> hashes(size());
+			for (size_t position{ 0 }; position < size(); ++position)
+			{
+				hashes[position] = _hasher(_keys[position]);
+			}
+
+			std::vector<size_t> sorted{ hashes };
+			std::sort(sorted.begin(), sorted.end());
+			if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+			{
+				throw std::invalid_argument("frozen_hash_tree: keys with identical hashes cannot be perfectly hashed");
+			}
+
+			size_t bucket_count{ std::max<size_t>(1, size() / BUCKET_SIZE) };
+			size_t slot_count{ size() };
+			for (size_t resize{ 0 }; !place(hashes, bucket_count, slot_count); ++resize)
+			{
+				if (resize == MAX_RESIZES)
+				{
+					throw std::runtime_error("frozen_hash_tree: perfect hash construction did not converge");
+				}
+
+				slot_count += slot_count / 16 + 1;
+			}
+		}
+
+		bool place(const std::vector<size_t>& hashes, size_t bucket_count, size_t slot_count)
+		{
+			std::vector<index_container> buckets(bucket_count);
+			for (Index position{ 0 }; position < hashes.size(); ++position)
+			{
+				buckets[hashes[position] % bucket_count].push_back(position);
+			}
+
+			std::vector<size_t> order(bucket_count);
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&buckets](size_t left, size_t right)
+				{
+					return buckets[left].size() > buckets[right].size();
+				});
+
+			_displacements.assign(bucket_count, 0);
+			_slots.assign(slot_count, EMPTY);
+
+			std::vector<size_t> taken;
+			for (size_t bucket_index : order)
+			{
+				const index_container& bucket{ buckets[bucket_index] };
+				if (bucket.empty())
+				{
+					break;
+				}
+
+				uint32_t displacement{ 0 };
+				for (; displacement < MAX_DISPLACEMENT; ++displacement)
+				{
+					taken.clear();
+					for (Index position : bucket)
+					{
+						size_t slot{ _mix_hash(hashes[position], displacement) % slot_count };
+						if (_slots[slot] != EMPTY || std::find(taken.begin(), taken.end(), slot) != taken.end())
+						{
+							break;
+						}
+						taken.push_back(slot);
+					}
+
+					if (taken.size() == bucket.size())
+					{
+						break;
+					}
+				}
+
+				if (displacement == MAX_DISPLACEMENT)
+				{
+					return false;
+				}
+
+				_displacements[bucket_index] = displacement;
+				for (size_t i{ 0 }; i < bucket.size(); ++i)
+				{
+					_slots[taken[i]] = bucket[i];
+				}
+			}
+
+			return true;
+		}
+	};
+
+}
+
+#endif
@@ -2,39 +2,209 @@
 #define	BYTE_HASHTREE_H
 
 #include "sparse_vector.h"
+#include "hash_tree_codec.h"
+#include "hash_tree_transaction.h"
+#include "hash_tree_log.h"
+#include "frozen_hash_tree.h"
+#include "cow_sparse_vector.h"
+#include "tracked_sparse_vector.h"
+#include "hash_tree_filter.h"
+#include "hash_tree_btree.h"
 
 #include <vector>
-#include <xhash>
+#include <cstdint>
+#include <functional>
 #include <type_traits>
 #include <utility>
 #include <limits>
 #include <algorithm>
 #include <queue>
+#include <unordered_map>
+#include <stdexcept>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <bit>
 
 namespace Byte
 {
 
 	inline constexpr size_t _EMPTY_INDEX = std::numeric_limits<size_t>::max();
 
-	template<typename K, typename T>
+	template<typename Index>
+	inline constexpr Index _empty_index = std::numeric_limits<Index>::max();
+
+	template<typename K, typename T, typename Index = size_t, bool = !stores_key_hash<K>::value, bool = false, typename Childs = std::vector<Index>>
 	struct hash_tree_node
 	{
 		using value_type = std::pair<const K, T>;
-		using child_container = std::vector<size_t>;
+		using child_container = Childs;
+
+		value_type pair;
+		size_t hash_value;
+		child_container childs;
+		Index parent_index{ _empty_index<Index> };
+		Index next_index{ _empty_index<Index> };
+	};
+
+	template<typename K, typename T, typename Index, typename Childs>
+	struct hash_tree_node<K, T, Index, true, false, Childs>
+	{
+		using value_type = std::pair<const K, T>;
+		using child_container = Childs;
+
+		value_type pair;
+		child_container childs;
+		Index parent_index{ _empty_index<Index> };
+		Index next_index{ _empty_index<Index> };
+	};
+
+	template<typename K, typename T, typename Index, typename Childs>
+	struct hash_tree_node<K, T, Index, false, true, Childs>
+	{
+		using value_type = std::pair<const K, T>;
+		using child_container = Childs;
 
 		value_type pair;
 		size_t hash_value;
+		uint64_t fingerprint;
 		child_container childs;
-		size_t parent_index{ _EMPTY_INDEX };
-		size_t next_index{ _EMPTY_INDEX };
+		Index parent_index{ _empty_index<Index> };
+		Index next_index{ _empty_index<Index> };
+	};
+
+	template<typename K, typename Hasher, typename Keyeq, typename Index>
+	struct hash_tree_chain
+	{
+		inline static constexpr Index EMPTY{ _empty_index<Index> };
+		inline static constexpr bool STORES_HASH{ stores_key_hash<K>::value };
+		inline static constexpr bool STORES_FINGERPRINT{ STORES_HASH && key_fingerprint<K>::enabled
+			&& (std::is_same<Keyeq, std::equal_to<K>>::value || std::is_same<Keyeq, std::equal_to<>>::value) };
+
+		template<typename T, typename Childs = std::vector<Index>>
+		using node_type = hash_tree_node<K, T, Index, !STORES_HASH, STORES_FINGERPRINT, Childs>;
+
+		template<typename Nodes, typename T>
+		static Index emplace(Nodes& nodes, size_t hash_value, K&& key, T&& value)
+		{
+			if constexpr (STORES_FINGERPRINT)
+			{
+				uint64_t fingerprint{ key_fingerprint<K>::make(key) };
+				return static_cast<Index>(nodes.emplace(std::make_pair<K, T>(std::move(key), std::move(value)), hash_value, fingerprint));
+			}
+			else if constexpr (STORES_HASH)
+			{
+				return static_cast<Index>(nodes.emplace(std::make_pair<K, T>(std::move(key), std::move(value)), hash_value));
+			}
+			else
+			{
+				return static_cast<Index>(nodes.emplace(std::make_pair<K, T>(std::move(key), std::move(value))));
+			}
+		}
+
+		template<typename Node>
+		static size_t hash_of(const Node& node, const Hasher& hasher)
+		{
+			if constexpr (STORES_HASH)
+			{
+				return node.hash_value;
+			}
+			else
+			{
+				return hasher(node.pair.first);
+			}
+		}
+
+		template<typename Node>
+		static bool matches(const Node& node, size_t hash_value, const K& key, const Keyeq& keyeq)
+		{
+			if constexpr (STORES_FINGERPRINT)
+			{
+				if (node.hash_value != hash_value)
+				{
+					return false;
+				}
+
+				uint64_t fingerprint{ key_fingerprint<K>::make(key) };
+				if (node.fingerprint != fingerprint)
+				{
+					return false;
+				}
+
+				return key_fingerprint<K>::exact(fingerprint) || keyeq(node.pair.first, key);
+			}
+			else if constexpr (STORES_HASH)
+			{
+				return node.hash_value == hash_value && keyeq(node.pair.first, key);
+			}
+			else
+			{
+				return keyeq(node.pair.first, key);
+			}
+		}
+
+		template<typename Nodes>
+		static Index find(const Nodes& nodes, Index _index, size_t hash_value, const K& key, const Keyeq& keyeq)
+		{
+			while (_index != EMPTY)
+			{
+				const auto& node{ nodes[_index] };
+				if (matches(node, hash_value, key, keyeq))
+				{
+					return _index;
+				}
+				_index = node.next_index;
+			}
+
+			return EMPTY;
+		}
+
+		template<typename Nodes, typename Table>
+		static void link(Nodes& nodes, Table& table, size_t map_index, Index node_index)
+		{
+			Index tail_index{ std::as_const(table)[map_index] };
+			if (tail_index == EMPTY)
+			{
+				table[map_index] = node_index;
+			}
+			else
+			{
+				while (std::as_const(nodes)[tail_index].next_index != EMPTY)
+				{
+					tail_index = std::as_const(nodes)[tail_index].next_index;
+				}
+				nodes[tail_index].next_index = node_index;
+			}
+		}
+
+		template<typename Nodes, typename Table>
+		static void unlink(Nodes& nodes, Table& table, size_t map_index, Index node_index)
+		{
+			Index next_index{ std::as_const(nodes)[node_index].next_index };
+
+			if (std::as_const(table)[map_index] == node_index)
+			{
+				table[map_index] = next_index;
+			}
+			else
+			{
+				Index prev_index{ std::as_const(table)[map_index] };
+				while (std::as_const(nodes)[prev_index].next_index != node_index)
+				{
+					prev_index = std::as_const(nodes)[prev_index].next_index;
+				}
+				nodes[prev_index].next_index = next_index;
+			}
+
+			nodes[node_index].next_index = EMPTY;
+		}
 	};
 
-	template<typename K, typename T>
+	template<typename Container, typename T, typename Index = size_t>
 	class hash_tree_iterator 
 	{
 	private:
-		using node_type = hash_tree_node<typename std::remove_const<K>::type, T>;
-		using node_ptr = std::conditional_t<std::is_const<T>::value, const node_type*, node_type*>;
+		using container_ptr = std::conditional_t<std::is_const<T>::value, const Container*, Container*>;
 
 	public:
 		using iterator_category = std::forward_iterator_tag;
@@ -44,12 +214,12 @@ namespace Byte
 		using reference = value_type&;
 
 	private:
-		node_ptr _nodes;
-		std::vector<size_t> _visit;
+		container_ptr _nodes;
+		std::vector<Index> _visit;
 		size_t _index{ 0 };
 
 	public:
-		hash_tree_iterator(node_ptr nodes, size_t head_index, size_t index, size_t size)
+		hash_tree_iterator(container_ptr nodes, Index head_index, size_t index, size_t size)
 			:_nodes{ nodes }, _index{index}
 		{
 			_visit.reserve(size);
@@ -58,19 +228,22 @@ namespace Byte
 
 		T& operator*()
 		{
-			return _nodes[_visit[_index]].pair.second;
+			return (*_nodes)[_visit[_index]].pair.second;
 		}
 
 		T* operator->()
 		{
-			return &_nodes->at[_visit[_index]].pair.second;
+			return &(*_nodes)[_visit[_index]].pair.second;
 		}
 
 		hash_tree_iterator& operator++()
 		{
-			for (size_t i : _nodes[_visit[_index]].childs)
+			for (Index i : std::as_const(*_nodes)[_visit[_index]].childs)
 			{
-				_visit.push_back(i);
+				if (i != _empty_index<Index>)
+				{
+					_visit.push_back(i);
+				}
 			}
 			++_index;
 
@@ -94,21 +267,142 @@ namespace Byte
 		}
 	};
 
+	struct hash_tree_storage
+	{
+		template<typename Node>
+		using node_container = sparse_vector<Node>;
+
+		template<typename Index>
+		using map_container = std::vector<Index>;
+
+		using filter_type = no_hash_filter;
+
+		using child_compare = void;
+
+		template<typename K, typename Index>
+		using ordered_index = no_ordered_index<K, Index>;
+	};
+
+	template<typename Base = hash_tree_storage>
+	struct with_bloom_filter : Base
+	{
+		using filter_type = blocked_bloom_filter;
+	};
+
+	template<typename Compare = std::less<>, typename Base = hash_tree_storage>
+	struct with_sorted_childs : Base
+	{
+		using child_compare = Compare;
+	};
+
+	template<typename Compare = std::less<>, typename Base = hash_tree_storage>
+	struct with_ordered_keys : Base
+	{
+		template<typename K, typename Index>
+		using ordered_index = btree_index<K, Index, Compare>;
+	};
+
+	template<typename Base = hash_tree_storage>
+	struct with_cow_nodes : Base
+	{
+		template<typename Node>
+		using node_container = cow_sparse_vector<Node>;
+
+		template<typename Index>
+		using map_container = cow_vector<Index>;
+	};
+
+	template<typename Base = hash_tree_storage>
+	struct with_tracked_nodes : Base
+	{
+		template<typename Node>
+		using node_container = tracked_sparse_vector<Node>;
+
+		template<typename Index>
+		using map_container = tracked_vector<Index>;
+	};
+
+	using filtered_hash_tree_storage = with_bloom_filter<>;
+
+	template<typename Compare = std::less<>>
+	using sorted_hash_tree_storage = with_sorted_childs<Compare>;
+
+	template<typename Compare = std::less<>>
+	using ordered_hash_tree_storage = with_ordered_keys<Compare>;
+
+	using cow_hash_tree_storage = with_cow_nodes<>;
+
+	using tracked_hash_tree_storage = with_tracked_nodes<>;
+
 	template<
 		typename K, 
 		typename T, 
-		typename Hasher = std::hash<K>, 
-		typename Keyeq = std::equal_to<K>>
+		typename Hasher = default_hash<K>, 
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t,
+		typename Storage = hash_tree_storage>
 	class hash_tree
 	{
 	private:
+		static_assert(std::is_unsigned<Index>::value, "hash_tree index type must be unsigned");
+
+		inline static constexpr Index _EMPTY_INDEX{ _empty_index<Index> };
 		inline static constexpr double MAX_LOAD{ 0.9 };
 		inline static constexpr double MIN_LOAD{ 0.2 };
+		inline static constexpr size_t LOAD_RESERVE{ 1ULL << 16 };
+
+		using chain = hash_tree_chain<K, Hasher, Keyeq, Index>;
+
+		inline static constexpr bool STORES_HASH{ chain::STORES_HASH };
+		inline static constexpr bool STORES_FINGERPRINT{ chain::STORES_FINGERPRINT };
+
+		using node_type = typename chain::template node_type<T>;
+		using node_container = typename Storage::template node_container<node_type>;
+		using node_map = typename Storage::template map_container<Index>;
+		using node_filter = typename Storage::filter_type;
+		using child_compare = typename Storage::child_compare;
+
+		inline static constexpr bool SORTED_CHILDS{ !std::is_void<child_compare>::value };
+
+		using key_compare = std::conditional_t<SORTED_CHILDS, child_compare, std::less<>>;
+		using key_index = typename Storage::template ordered_index<K, Index>;
+		using head_container = std::vector<Index>;
+
+		inline static constexpr size_t WIDE_CHILDS{ 256 };
+
+		inline static constexpr unsigned char _INSERTED{ 1 };
+		inline static constexpr unsigned char _ERASED{ 2 };
+		inline static constexpr unsigned char _SAVED{ 4 };
+		inline static constexpr unsigned char _STALE{ 8 };
+
+		struct transaction_journal
+		{
+			Index head_index{ _EMPTY_INDEX };
+			std::vector<unsigned char> marks;
+			std::vector<Index> inserted;
+			std::vector<Index> erased;
+			std::vector<Index> stale;
+			std::vector<std::pair<Index, typename node_type::child_container>> childs;
+			std::vector<std::pair<Index, Index>> parents;
+			std::vector<std::pair<Index, T>> values;
+			bool replay{ false };
+		};
+
+		struct child_lookup
+		{
+			std::unordered_map<Index, size_t> positions;
+			size_t indexed{ 0 };
+			size_t tombstones{ 0 };
+		};
+
+		template<typename>
+		friend class hash_tree_transaction;
 
-		using node_type = hash_tree_node<K,T>;
-		using node_container = sparse_vector<node_type>;
-		using node_map = std::vector<size_t>;
-		using head_container = std::vector<size_t>;
+		template<typename, typename, typename, typename, typename, typename>
+		friend class cache_hash_tree;
+
+		template<typename, typename, typename, typename, typename, typename>
+		friend class ttl_hash_tree;
 
 	public:
 		using hasher = Hasher;
@@ -125,24 +419,61 @@ namespace Byte
 		using reference = value_type&;
 		using const_reference = const value_type&;
 
-		using iterator = hash_tree_iterator<K, T>;
-		using const_iterator = hash_tree_iterator<K, const T>;
+		using index_type = Index;
+
+		using iterator = hash_tree_iterator<node_container, T, Index>;
+		using const_iterator = hash_tree_iterator<node_container, const T, Index>;
+		using frozen_type = frozen_hash_tree<K, T, Hasher, Keyeq, Index>;
+		using transaction = hash_tree_transaction<hash_tree>;
+		using log_type = change_log<K, T>;
 
 	private:
 		node_container _nodes;
-		node_map _table{ _EMPTY_INDEX, _EMPTY_INDEX };
-		size_t _head_index{ _EMPTY_INDEX };
+		node_map _table = node_map(2, _EMPTY_INDEX);
+		node_filter _filter;
+		std::unordered_map<Index, child_lookup> _child_indices;
+		key_index _ordered;
+		Index _head_index{ _EMPTY_INDEX };
 		Hasher _hasher;
 		Keyeq _keyeq;
+		[[no_unique_address]] key_compare _compare;
+		log_type* _log{ nullptr };
 
 	public:
 		hash_tree() = default;
 
-		hash_tree(const hash_tree& left) = default;
+		hash_tree(const hash_tree& left)
+			:_nodes{ left._nodes },
+			_table{ left._table },
+			_filter{ left._filter },
+			_child_indices{ left._child_indices },
+			_ordered{ left._ordered },
+			_head_index{ left._head_index },
+			_hasher{ left._hasher },
+			_keyeq{ left._keyeq },
+			_compare{ left._compare }
+		{
+		}
 
 		hash_tree(hash_tree&& right) noexcept = default;
 
-		hash_tree& operator=(const hash_tree& left) = default;
+		hash_tree& operator=(const hash_tree& left)
+		{
+			if (this != &left)
+			{
+				_nodes = left._nodes;
+				_table = left._table;
+				_filter = left._filter;
+				_child_indices = left._child_indices;
+				_ordered = left._ordered;
+				_head_index = left._head_index;
+				_hasher = left._hasher;
+				_keyeq = left._keyeq;
+				_compare = left._compare;
+			}
+
+			return *this;
+		}
 
 		hash_tree& operator=(hash_tree&& right) noexcept = default;
 
@@ -160,16 +491,16 @@ namespace Byte
 
 		void insert(K&& key, T&& value)
 		{
-			size_t _index{ _insert(std::move(key), std::move(value)) };
+			Index _index{ _insert(std::move(key), std::move(value)) };
 			if (_head_index == _EMPTY_INDEX)
 			{
 				_head_index = _index;
 			}
 			else
 			{
-				_nodes[_head_index].childs.push_back(_index);
-				_nodes[_index].parent_index = _head_index;
+				link_child(_head_index, _index);
 			}
+			log_insert(_index, false);
 		}
 
 		void insert(const K& key, const T& value, const K& parent)
@@ -184,60 +515,53 @@ namespace Byte
 
 		void insert(K&& key, T&& value, const K& parent)
 		{
-			size_t _index{ _insert(std::move(key), std::move(value)) };
-			size_t parent_index{ index(parent) };
-			_nodes[parent_index].childs.push_back(_index);
-			_nodes[_index].parent_index = parent_index;
+			Index _index{ _insert(std::move(key), std::move(value)) };
+			Index parent_index{ index(parent) };
+			link_child(parent_index, _index);
+			log_insert(_index, true);
 		}
 
 		void erase(const K& key)
 		{
-			size_t _index{ index(key) };
-
-			if (_index == _head_index)
-			{
-				clear();
-				return;
-			}
-
-			if (_nodes[_index].parent_index != _EMPTY_INDEX)
-			{
-				remove_child(_index);
-			}
-			
-			std::queue<size_t> visit;
-			visit.push(_index);
-			while (!visit.empty())
+			if (_log)
 			{
-				for (size_t i : _nodes[visit.front()].childs)
-				{
-					visit.push(i);
-				}
-				_nodes.erase(visit.front());
-				visit.pop();
+				_log->append(transaction_erase<K>{ key });
 			}
 
-			if (load_factor() < MIN_LOAD)
-			{
-				_nodes.shrink_to_fit();
-				rehash(table_size() / 2);
-			}
+			_erase(index(key));
 		}
 
 		void set_parent(const K& key, const K& new_parent)
 		{
-			size_t _index{ index(key) };
-			size_t parent_index{ index(new_parent) };
+			Index _index{ index(key) };
+			Index parent_index{ index(new_parent) };
 
-			_set_parent(_index, parent_index, _nodes[parent_index].childs.end());
+			_set_parent(_index, parent_index, _EMPTY_INDEX);
+			log_set_parent(key, new_parent, std::numeric_limits<size_t>::max());
 		}
 
-		void set_parent(const K& key, const K& new_parent, size_t _index)
+		void set_parent(const K& key, const K& new_parent, size_t position)
 		{
-			size_t _index{ index(key) };
-			size_t parent_index{ index(new_parent) };
+			Index _index{ index(key) };
+			Index parent_index{ index(new_parent) };
 
-			_set_parent(_index, parent_index, _nodes[parent_index].childs.begin() + _index);
+			_set_parent(_index, parent_index, position);
+			log_set_parent(key, new_parent, position);
+		}
+
+		void assign(const K& key, const T& value)
+		{
+			assign(key, T{ value });
+		}
+
+		void assign(const K& key, T&& value)
+		{
+			T& mapped{ _nodes[index(key)].pair.second };
+			mapped = std::move(value);
+			if (_log)
+			{
+				_log->append(transaction_assign<K, T>{ key, mapped });
+			}
 		}
 
 		T& at(const K& key)
@@ -252,7 +576,7 @@ namespace Byte
 
 		T& operator[](const K& key)
 		{
-			size_t _index{ index(key) };
+			Index _index{ index(key) };
 
 			if (_index == _EMPTY_INDEX)
 			{
@@ -270,149 +594,1323 @@ namespace Byte
 
 		bool contains(const K& key) const
 		{
-			return index() != _EMPTY_INDEX;
+			return index(key) != _EMPTY_INDEX;
 		}
 
-		double load_factor() const
+		T* find_child(const K& parent, const K& key)
 		{
-			return size() / static_cast<double>(table_size());
+			return const_cast<T*>(std::as_const(*this).find_child(parent, key));
 		}
 
-		iterator begin()
+		const T* find_child(const K& parent, const K& key) const
 		{
-			return iterator{ _nodes.data(), _head_index, 0, size() };
-		}
+			Index _index{ index(key) };
+			if (_index == _EMPTY_INDEX)
+			{
+				return nullptr;
+			}
 
-		iterator end()
-		{
-			return iterator{ _nodes.data(), _EMPTY_INDEX, size(), size() };
-		}
+			const node_type& node{ _nodes[_index] };
+			if (node.parent_index == _EMPTY_INDEX || !_keyeq(_nodes[node.parent_index].pair.first, parent))
+			{
+				return nullptr;
+			}
 
-		const_iterator begin() const
-		{
-			return const_iterator{ _nodes.data(), _head_index, 0, size()};
+			return &node.pair.second;
 		}
 
-		const_iterator end() const
+		T* find_path(std::span<const K> path)
 		{
-			return const_iterator{ _nodes.data(), _EMPTY_INDEX, size(), size() };
+			return const_cast<T*>(std::as_const(*this).find_path(path));
 		}
 
-		size_t size() const
+		const T* find_path(std::span<const K> path) const
 		{
-			return _nodes.size();
-		}
+			Index _index{ path.empty() ? _EMPTY_INDEX : index(path.back()) };
+			if (_index == _EMPTY_INDEX)
+			{
+				return nullptr;
+			}
 
-		size_t table_size() const
-		{
-			return _table.size();
+			const node_type& node{ _nodes[_index] };
+			Index parent_index{ node.parent_index };
+			for (size_t position{ path.size() - 1 }; position != 0; --position)
+			{
+				if (parent_index == _EMPTY_INDEX)
+				{
+					return nullptr;
+				}
+
+				const node_type& parent{ _nodes[parent_index] };
+				if (!_keyeq(parent.pair.first, path[position - 1]))
+				{
+					return nullptr;
+				}
+				parent_index = parent.parent_index;
+			}
+
+			return &node.pair.second;
 		}
 
-		void clear()
+		size_t child_count(const K& key) const
 		{
-			_head_index = _EMPTY_INDEX;
-			_table.clear();
-			_nodes.clear();
+			Index _index{ index(key) };
+			auto it{ _child_indices.find(_index) };
+			return _nodes[_index].childs.size() - (it == _child_indices.end() ? 0 : it->second.tombstones);
 		}
 
-	private:
-		size_t index(const K& key) const
+		template<typename Function>
+		void for_each_child(const K& key, Function&& function)
 		{
-			size_t hash_value{ _hasher(key) };
-			size_t _index{ _table[hash_value % table_size()] };
-
-			if (_index == _EMPTY_INDEX)
+			for (Index child_index : std::as_const(_nodes)[index(key)].childs)
 			{
-				return _EMPTY_INDEX;
+				if (child_index != _EMPTY_INDEX)
+				{
+					auto& pair{ _nodes[child_index].pair };
+					function(pair.first, pair.second);
+				}
 			}
+		}
 
-			const node_type* it{ &_nodes[_index] };
-			while (it->next_index != _EMPTY_INDEX)
+		template<typename Function>
+		void for_each_child(const K& key, Function&& function) const
+		{
+			for (Index child_index : _nodes[index(key)].childs)
 			{
-				if (it->hash_value == hash_value && _keyeq(it->pair.first, key))
+				if (child_index != _EMPTY_INDEX)
 				{
-					return _index;
+					const auto& pair{ _nodes[child_index].pair };
+					function(pair.first, pair.second);
 				}
-				_index = it->next_index;
-				it = &_nodes[_index];
 			}
+		}
+
+		template<typename Key, typename Function>
+		void for_each_child(const K& key, const Key& lower, const Key& upper, Function&& function) const
+		{
+			static_assert(SORTED_CHILDS, "hash_tree child ranges require a sorted storage policy");
 
-			if (it->hash_value == hash_value && _keyeq(it->pair.first, key))
+			const typename node_type::child_container& childs{ _nodes[index(key)].childs };
+			for (auto it{ lower_child(childs, lower) }; it != childs.end(); ++it)
 			{
-				return _index;
+				const auto& pair{ _nodes[*it].pair };
+				if (!_compare(pair.first, upper))
+				{
+					break;
+				}
+				function(pair.first, pair.second);
 			}
-
-			return _EMPTY_INDEX;
 		}
 
-		size_t _insert(K&& key, T&& value)
+		const value_type* lower_bound(const K& key) const
 		{
-			if (load_factor() > MAX_LOAD)
-			{
-				rehash(table_size() * 2);
-			}
+			static_assert(key_index::enabled, "hash_tree range queries require an ordered storage policy");
 
-			size_t hash_value{ _hasher(key) };
-			size_t _index{ _nodes.emplace(std::make_pair<K, T>(std::move(key), std::move(value)), hash_value) };
+			const value_type* found{ nullptr };
+			_ordered.scan(key, [&](const K&, Index node_index)
+				{
+					found = &_nodes[node_index].pair;
+					return false;
+				});
 
-			insert_map(hash_value % table_size(), _index);
+			return found;
+		}
 
-			return _index;
+		template<typename Function>
+		void for_each_in_range(const K& lower, const K& upper, Function&& function) const
+		{
+			static_assert(key_index::enabled, "hash_tree range queries require an ordered storage policy");
+
+			_ordered.scan(lower, upper, [&](const K&, Index node_index)
+				{
+					const value_type& pair{ _nodes[node_index].pair };
+					function(pair.first, pair.second);
+					return true;
+				});
 		}
 
-		void _set_parent(size_t _index, size_t parent_index, node_container::iterator _where)
+		template<typename Function>
+		void for_each_in_range(const K& lower, const K& upper, const K& ancestor, Function&& function) const
 		{
-			if (_nodes[_index].parent_index != _EMPTY_INDEX)
+			static_assert(key_index::enabled, "hash_tree range queries require an ordered storage policy");
+
+			Index ancestor_index{ index(ancestor) };
+			if (ancestor_index == _EMPTY_INDEX)
 			{
-				remove_child(_index);
+				return;
 			}
 
-			_nodes[parent_index].childs.insert(_where, _index);
-			_nodes[_index].parent_index = parent_index;
+			_ordered.scan(lower, upper, [&](const K&, Index node_index)
+				{
+					for (Index it{ node_index }; it != _EMPTY_INDEX; it = _nodes[it].parent_index)
+					{
+						if (it == ancestor_index)
+						{
+							const value_type& pair{ _nodes[node_index].pair };
+							function(pair.first, pair.second);
+							break;
+						}
+					}
+					return true;
+				});
 		}
 
-		void remove_child(size_t child_index)
+		double load_factor() const
 		{
-			typename node_type::child_container& old_childs{ _nodes[_nodes[child_index].parent_index].childs };
-			old_childs.erase(std::remove(old_childs.begin(), old_childs.end(), child_index), old_childs.end());
+			return size() / static_cast<double>(table_size());
 		}
 
-		void rehash(size_t new_size)
+		iterator begin()
 		{
-			for (node_type& node : _nodes)
-			{
-				node.next_index = _EMPTY_INDEX;
-			}
-
-			_table.resize(new_size);
-			_table.shrink_to_fit();
-			_table.assign(new_size, _EMPTY_INDEX);
+			return iterator{ &_nodes, _head_index, 0, size() };
+		}
 
-			for (auto it{ _nodes.begin() }; it != _nodes.end(); ++it)
-			{
-				size_t map_index{ it->hash_value % table_size() };
-				insert_map(map_index, it.index());
-			}
+		iterator end()
+		{
+			return iterator{ &_nodes, _EMPTY_INDEX, size(), size() };
 		}
 
-		void insert_map(size_t map_index, size_t node_index)
+		const_iterator begin() const
 		{
-			if (_table[map_index] == _EMPTY_INDEX)
-			{
-				_table[map_index] = node_index;
+			return const_iterator{ &_nodes, _head_index, 0, size()};
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator{ &_nodes, _EMPTY_INDEX, size(), size() };
+		}
+
+		size_t size() const
+		{
+			return _nodes.size();
+		}
+
+		size_t table_size() const
+		{
+			return _table.size();
+		}
+
+		size_t max_size() const
+		{
+			return std::min<size_t>(_EMPTY_INDEX - 1, std::numeric_limits<size_t>::max() / (2 * sizeof(node_type)));
+		}
+
+		void reserve(size_t count)
+		{
+			if (count > max_size())
+			{
+				throw std::length_error("hash_tree: reserve exceeds max_size");
+			}
+
+			_nodes.reserve(count);
+
+			size_t new_size{ table_size() };
+			while (count > new_size * MAX_LOAD)
+			{
+				new_size *= 2;
+			}
+
+			if (new_size != table_size())
+			{
+				rehash(new_size);
+			}
+		}
+
+		template<typename KeyCodec = codec<K>, typename ValueCodec = codec<T>>
+		void save(std::ostream& out, const KeyCodec& key_codec = {}, const ValueCodec& value_codec = {}) const
+		{
+			write_varint(out, size());
+			if (_head_index == _EMPTY_INDEX)
+			{
+				return;
+			}
+
+			std::vector<std::pair<Index, size_t>> visit{ { _head_index, 0 } };
+			size_t position{ 0 };
+			while (!visit.empty() && out)
+			{
+				auto [node_index, parent_position] { visit.back() };
+				visit.pop_back();
+
+				const node_type& node{ _nodes[node_index] };
+				write_varint(out, node_index == _head_index ? 0 : position - parent_position);
+				key_codec.write(out, node.pair.first);
+				value_codec.write(out, node.pair.second);
+
+				for (auto it{ node.childs.rbegin() }; it != node.childs.rend(); ++it)
+				{
+					if (*it != _EMPTY_INDEX)
+					{
+						visit.emplace_back(*it, position);
+					}
+				}
+				++position;
+			}
+		}
+
+		template<typename KeyCodec = codec<K>, typename ValueCodec = codec<T>>
+		void load(std::istream& in, const KeyCodec& key_codec = {}, const ValueCodec& value_codec = {})
+		{
+			_clear();
+
+			size_t count{ read_varint(in) };
+			if (count > max_size())
+			{
+				in.setstate(std::ios::failbit);
+				return;
+			}
+
+			size_t reserved{ std::min(count, LOAD_RESERVE) };
+			reserve(reserved);
+
+			std::vector<std::pair<size_t, Index>> path;
+			for (size_t position{ 0 }; position < count; ++position)
+			{
+				size_t parent_delta{ read_varint(in) };
+				K key{ key_codec.read(in) };
+				T value{ value_codec.read(in) };
+
+				if (!in || (position != 0 && (parent_delta == 0 || parent_delta > position)))
+				{
+					in.setstate(std::ios::failbit);
+					_clear();
+					return;
+				}
+
+				if (position == reserved)
+				{
+					reserved = std::min(count, reserved * 2);
+					reserve(reserved);
+				}
+
+				Index _index{ _emplace(std::move(key), std::move(value)) };
+				if (position == 0)
+				{
+					_head_index = _index;
+				}
+				else
+				{
+					size_t parent_position{ position - parent_delta };
+					while (!path.empty() && path.back().first != parent_position)
+					{
+						path.pop_back();
+					}
+
+					if (path.empty())
+					{
+						in.setstate(std::ios::failbit);
+						_clear();
+						return;
+					}
+
+					link_child(path.back().second, _index);
+				}
+				path.emplace_back(position, _index);
+			}
+		}
+
+		template<typename KeyCodec = codec<K>, typename ValueCodec = codec<T>>
+		void save_delta(std::ostream& out, const KeyCodec& key_codec = {}, const ValueCodec& value_codec = {})
+		{
+			const node_container& nodes{ _nodes };
+			const node_map& table{ _table };
+
+			size_t block_count{ nodes.block_count() };
+			size_t dirty_blocks{ 0 };
+			for (size_t block_index{ 0 }; block_index < block_count; ++block_index)
+			{
+				dirty_blocks += nodes.dirty(block_index);
+			}
+
+			write_varint(out, block_count);
+			write_varint(out, static_cast<Index>(_head_index + 1));
+			write_varint(out, dirty_blocks);
+			for (size_t block_index{ 0 }; block_index < block_count && out; ++block_index)
+			{
+				if (!nodes.dirty(block_index))
+				{
+					continue;
+				}
+
+				size_t first{ block_index * _BITSET_SIZE };
+				uint64_t mask{ 0 };
+				for (size_t slot{ 0 }; slot < _BITSET_SIZE; ++slot)
+				{
+					mask |= static_cast<uint64_t>(nodes.test(first + slot)) << slot;
+				}
+
+				write_varint(out, block_index);
+				codec<uint64_t>{}.write(out, mask);
+				for (size_t slot{ 0 }; slot < _BITSET_SIZE; ++slot)
+				{
+					if (!(mask >> slot & 1))
+					{
+						continue;
+					}
+
+					const node_type& node{ nodes[first + slot] };
+					key_codec.write(out, node.pair.first);
+					value_codec.write(out, node.pair.second);
+					write_varint(out, static_cast<Index>(node.parent_index + 1));
+					write_varint(out, static_cast<Index>(node.next_index + 1));
+					write_varint(out, node.childs.size() - std::count(node.childs.begin(), node.childs.end(), _EMPTY_INDEX));
+					for (Index child_index : node.childs)
+					{
+						if (child_index != _EMPTY_INDEX)
+						{
+							write_varint(out, child_index);
+						}
+					}
+				}
+			}
+
+			size_t range_count{ table.range_count() };
+			size_t dirty_ranges{ 0 };
+			for (size_t range_index{ 0 }; range_index < range_count; ++range_index)
+			{
+				dirty_ranges += table.dirty(range_index);
+			}
+
+			write_varint(out, table.size());
+			write_varint(out, dirty_ranges);
+			for (size_t range_index{ 0 }; range_index < range_count && out; ++range_index)
+			{
+				if (!table.dirty(range_index))
+				{
+					continue;
+				}
+
+				write_varint(out, range_index);
+				size_t last{ std::min(table.size(), (range_index + 1) * node_map::RANGE_SIZE) };
+				for (size_t map_index{ range_index * node_map::RANGE_SIZE }; map_index < last; ++map_index)
+				{
+					write_varint(out, static_cast<Index>(table[map_index] + 1));
+				}
+			}
+
+			if (out)
+			{
+				_nodes.clean();
+				_table.clean();
+			}
+		}
+
+		template<typename KeyCodec = codec<K>, typename ValueCodec = codec<T>>
+		void load_delta(std::istream& in, const KeyCodec& key_codec = {}, const ValueCodec& value_codec = {})
+		{
+			size_t block_count{ read_varint(in) };
+			Index head_index{ static_cast<Index>(read_varint(in) - 1) };
+			_child_indices.clear();
+			size_t dirty_blocks{ read_varint(in) };
+			if (block_count > max_size() / _BITSET_SIZE)
+			{
+				in.setstate(std::ios::failbit);
+				_clear();
+				return;
+			}
+
+			for (size_t node_index{ block_count * _BITSET_SIZE }; node_index < _nodes.capacity(); ++node_index)
+			{
+				if (_nodes.test(node_index))
+				{
+					_nodes.erase(node_index);
+				}
+			}
+
+			for (size_t i{ 0 }; i < dirty_blocks && in; ++i)
+			{
+				size_t block_index{ read_varint(in) };
+				uint64_t mask{ codec<uint64_t>{}.read(in) };
+				if (block_index >= block_count)
+				{
+					in.setstate(std::ios::failbit);
+					break;
+				}
+
+				size_t first{ block_index * _BITSET_SIZE };
+				for (size_t slot{ 0 }; slot < _BITSET_SIZE && first < _nodes.capacity(); ++slot)
+				{
+					if (_nodes.test(first + slot))
+					{
+						_nodes.erase(first + slot);
+					}
+				}
+
+				for (size_t slot{ 0 }; slot < _BITSET_SIZE && in; ++slot)
+				{
+					if (!(mask >> slot & 1))
+					{
+						continue;
+					}
+
+					K key{ key_codec.read(in) };
+					T value{ value_codec.read(in) };
+					Index parent_index{ static_cast<Index>(read_varint(in) - 1) };
+					Index next_index{ static_cast<Index>(read_varint(in) - 1) };
+					typename node_type::child_container childs;
+					size_t child_count{ read_varint(in) };
+					for (size_t i{ 0 }; i < child_count && in; ++i)
+					{
+						childs.push_back(static_cast<Index>(read_varint(in)));
+					}
+
+					if (!in)
+					{
+						break;
+					}
+
+					_nodes.reserve(first + _BITSET_SIZE);
+					size_t hash_value{ _hasher(key) };
+					auto pair{ std::make_pair<K, T>(std::move(key), std::move(value)) };
+					if constexpr (STORES_FINGERPRINT)
+					{
+						uint64_t fingerprint{ key_fingerprint<K>::make(pair.first) };
+						_nodes.insert(first + slot, node_type{ std::move(pair), hash_value, fingerprint, std::move(childs), parent_index, next_index });
+					}
+					else if constexpr (STORES_HASH)
+					{
+						_nodes.insert(first + slot, node_type{ std::move(pair), hash_value, std::move(childs), parent_index, next_index });
+					}
+					else
+					{
+						_nodes.insert(first + slot, node_type{ std::move(pair), std::move(childs), parent_index, next_index });
+					}
+				}
+			}
+
+			size_t table_size{ read_varint(in) };
+			size_t dirty_ranges{ read_varint(in) };
+			size_t range_count{ (table_size + node_map::RANGE_SIZE - 1) / node_map::RANGE_SIZE };
+			if (!std::has_single_bit(table_size) || dirty_ranges > range_count
+				|| (table_size != _table.size() && dirty_ranges != range_count))
+			{
+				in.setstate(std::ios::failbit);
+			}
+
+			if (in && table_size != _table.size())
+			{
+				std::vector<Index> table;
+				for (size_t map_index{ 0 }; map_index < table_size && in; ++map_index)
+				{
+					if (map_index % node_map::RANGE_SIZE == 0 && read_varint(in) != map_index / node_map::RANGE_SIZE)
+					{
+						in.setstate(std::ios::failbit);
+					}
+					table.push_back(static_cast<Index>(read_varint(in) - 1));
+				}
+
+				if (in)
+				{
+					_table.assign(table_size, _EMPTY_INDEX);
+					for (size_t map_index{ 0 }; map_index < table_size; ++map_index)
+					{
+						_table[map_index] = table[map_index];
+					}
+				}
+			}
+			else
+			{
+				for (size_t i{ 0 }; i < dirty_ranges && in; ++i)
+				{
+					size_t range_index{ read_varint(in) };
+					if (range_index >= range_count)
+					{
+						in.setstate(std::ios::failbit);
+						break;
+					}
+
+					size_t last{ std::min(table_size, (range_index + 1) * node_map::RANGE_SIZE) };
+					for (size_t map_index{ range_index * node_map::RANGE_SIZE }; map_index < last; ++map_index)
+					{
+						_table[map_index] = static_cast<Index>(read_varint(in) - 1);
+					}
+				}
+			}
+
+			if (!in || _table.size() == 0 || !valid_links(head_index))
+			{
+				in.setstate(std::ios::failbit);
+				_clear();
+				return;
+			}
+
+			_head_index = head_index;
+			_nodes.shrink_to_fit();
+			_nodes.clean();
+			_table.clean();
+			rebuild_filter();
+
+			_ordered.clear();
+			for (auto it{ std::as_const(_nodes).begin() }; it != std::as_const(_nodes).end(); ++it)
+			{
+				_ordered.insert(it->pair.first, static_cast<Index>(it.index()));
+			}
+		}
+
+		transaction begin_transaction()
+		{
+			return transaction{ this };
+		}
+
+		void attach_log(log_type* log)
+		{
+			_log = log;
+		}
+
+		void detach_log()
+		{
+			_log = nullptr;
+		}
+
+		void apply_log(const log_type& log, log_sequence& sequence, size_t batch_size = 4096)
+		{
+			if (sequence < log.first_sequence())
+			{
+				throw std::out_of_range{ "hash_tree: log sequence is no longer retained" };
+			}
+
+			std::vector<transaction_operation<K, T>> batch;
+			batch.reserve(std::min<size_t>(batch_size, log.next_sequence() - sequence));
+			while (sequence < log.next_sequence())
+			{
+				log_sequence last{ std::min<log_sequence>(sequence + batch_size, log.next_sequence()) };
+				for (log_sequence it{ sequence }; it < last; ++it)
+				{
+					batch.push_back(log.at(it));
+				}
+
+				apply(batch, true);
+				batch.clear();
+				sequence = last;
+			}
+		}
+
+		hash_tree snapshot() const
+		{
+			return *this;
+		}
+
+		frozen_type freeze() const
+		{
+			std::vector<K> keys;
+			std::vector<T> values;
+			std::vector<Index> parents;
+
+			keys.reserve(size());
+			values.reserve(size());
+			parents.reserve(size());
+
+			std::vector<std::pair<Index, Index>> visit;
+			if (_head_index != _EMPTY_INDEX)
+			{
+				visit.emplace_back(_head_index, _EMPTY_INDEX);
+			}
+
+			while (!visit.empty())
+			{
+				auto [node_index, parent_position] { visit.back() };
+				visit.pop_back();
+
+				const node_type& node{ _nodes[node_index] };
+				Index position{ static_cast<Index>(keys.size()) };
+				keys.push_back(node.pair.first);
+				values.push_back(node.pair.second);
+				parents.push_back(parent_position);
+
+				for (auto it{ node.childs.rbegin() }; it != node.childs.rend(); ++it)
+				{
+					if (*it != _EMPTY_INDEX)
+					{
+						visit.emplace_back(*it, position);
+					}
+				}
+			}
+
+			return frozen_type{ std::move(keys), std::move(values), std::move(parents), _hasher, _keyeq };
+		}
+
+		void clear()
+		{
+			if (_log && _head_index != _EMPTY_INDEX)
+			{
+				_log->append(transaction_erase<K>{ std::as_const(_nodes)[_head_index].pair.first });
+			}
+
+			_clear();
+		}
+
+	private:
+		void _erase(Index _index)
+		{
+			if (_index == _head_index)
+			{
+				_clear();
+				return;
+			}
+
+			if (_nodes[_index].parent_index != _EMPTY_INDEX)
+			{
+				remove_child(_index);
+			}
+
+			std::queue<Index> visit;
+			visit.push(_index);
+			while (!visit.empty())
+			{
+				for (Index i : std::as_const(_nodes)[visit.front()].childs)
+				{
+					if (i != _EMPTY_INDEX)
+					{
+						visit.push(i);
+					}
+				}
+				remove_map(visit.front());
+				drop_child_index(visit.front());
+				_nodes.erase(visit.front());
+				visit.pop();
+			}
+
+			if (load_factor() < MIN_LOAD)
+			{
+				_nodes.shrink_to_fit();
+				rehash(table_size() / 2);
+			}
+		}
+
+		void _clear()
+		{
+			_head_index = _EMPTY_INDEX;
+			_table.assign(2, _EMPTY_INDEX);
+			_table.shrink_to_fit();
+			_filter.reset(0);
+			_child_indices.clear();
+			_ordered.clear();
+			_nodes.clear();
+		}
+
+		Index index(const K& key) const
+		{
+			size_t hash_value{ _hasher(key) };
+			if (!_filter.may_contain(hash_value))
+			{
+				return _EMPTY_INDEX;
+			}
+
+			return chain::find(_nodes, _table[hash_value % table_size()], hash_value, key, _keyeq);
+		}
+
+		Index _insert(K&& key, T&& value)
+		{
+			if (load_factor() > MAX_LOAD)
+			{
+				rehash(table_size() * 2);
+			}
+
+			return _emplace(std::move(key), std::move(value));
+		}
+
+		Index _emplace(K&& key, T&& value)
+		{
+			size_t hash_value{ _hasher(key) };
+			Index _index{ chain::emplace(_nodes, hash_value, std::move(key), std::move(value)) };
+
+			insert_map(hash_value % table_size(), _index);
+			_ordered.insert(std::as_const(_nodes)[_index].pair.first, _index);
+
+			return _index;
+		}
+
+		size_t hash_of(const node_type& node) const
+		{
+			return chain::hash_of(node, _hasher);
+		}
+
+		void _set_parent(Index _index, Index parent_index, size_t position)
+		{
+			if (_nodes[_index].parent_index != _EMPTY_INDEX)
+			{
+				remove_child(_index);
+			}
+
+			if constexpr (SORTED_CHILDS)
+			{
+				link_child(parent_index, _index);
+				return;
+			}
+
+			typename node_type::child_container& new_childs{ _nodes[parent_index].childs };
+			if (position < new_childs.size())
+			{
+				compact_tombstones(parent_index);
+			}
+
+			position = std::min(position, new_childs.size());
+			new_childs.insert(new_childs.begin() + position, _index);
+			_nodes[_index].parent_index = parent_index;
+		}
+
+		void remove_child(Index child_index)
+		{
+			Index parent_index{ std::as_const(_nodes)[child_index].parent_index };
+			typename node_type::child_container& old_childs{ _nodes[parent_index].childs };
+			if constexpr (SORTED_CHILDS)
+			{
+				auto it{ lower_child(old_childs, std::as_const(_nodes)[child_index].pair.first) };
+				while (*it != child_index)
+				{
+					++it;
+				}
+				old_childs.erase(it);
+				return;
+			}
+
+			if (old_childs.size() < WIDE_CHILDS && !_child_indices.contains(parent_index))
+			{
+				old_childs.erase(std::remove(old_childs.begin(), old_childs.end(), child_index), old_childs.end());
+				return;
+			}
+
+			child_lookup& lookup{ _child_indices[parent_index] };
+			auto it{ find_child_position(lookup, old_childs, child_index) };
+			if (it == lookup.positions.end())
+			{
+				index_childs(lookup, old_childs, 0);
+				it = find_child_position(lookup, old_childs, child_index);
+			}
+
+			old_childs[it->second] = _EMPTY_INDEX;
+			lookup.positions.erase(it);
+			++lookup.tombstones;
+
+			if (lookup.tombstones * 2 > old_childs.size())
+			{
+				compact_tombstones(parent_index);
+			}
+		}
+
+		auto find_child_position(child_lookup& lookup, const typename node_type::child_container& childs, Index child_index)
+		{
+			auto it{ lookup.positions.find(child_index) };
+			if (it != lookup.positions.end() && it->second < childs.size() && childs[it->second] == child_index)
+			{
+				return it;
+			}
+
+			if (lookup.indexed < childs.size())
+			{
+				index_childs(lookup, childs, lookup.indexed);
+				it = lookup.positions.find(child_index);
+				if (it != lookup.positions.end() && childs[it->second] == child_index)
+				{
+					return it;
+				}
+			}
+
+			return lookup.positions.end();
+		}
+
+		void link_child(Index parent_index, Index child_index)
+		{
+			typename node_type::child_container& childs{ _nodes[parent_index].childs };
+			if constexpr (SORTED_CHILDS)
+			{
+				const K& key{ std::as_const(_nodes)[child_index].pair.first };
+				if (!childs.empty() && !_compare(std::as_const(_nodes)[childs.back()].pair.first, key))
+				{
+					childs.insert(lower_child(childs, key), child_index);
+				}
+				else
+				{
+					childs.push_back(child_index);
+				}
+			}
+			else
+			{
+				childs.push_back(child_index);
+			}
+			_nodes[child_index].parent_index = parent_index;
+		}
+
+		template<typename Container, typename Key>
+		auto lower_child(Container& childs, const Key& key) const
+		{
+			return std::lower_bound(childs.begin(), childs.end(), key, [this](Index child_index, const Key& value)
+				{
+					return _compare(std::as_const(_nodes)[child_index].pair.first, value);
+				});
+		}
+
+		void index_childs(child_lookup& lookup, const typename node_type::child_container& childs, size_t first)
+		{
+			if (first == 0)
+			{
+				lookup.positions.clear();
+				lookup.tombstones = 0;
+			}
+
+			for (size_t position{ first }; position < childs.size(); ++position)
+			{
+				if (childs[position] == _EMPTY_INDEX)
+				{
+					++lookup.tombstones;
+				}
+				else
+				{
+					lookup.positions[childs[position]] = position;
+				}
+			}
+			lookup.indexed = childs.size();
+		}
+
+		void compact_tombstones(Index node_index)
+		{
+			if (_child_indices.erase(node_index))
+			{
+				compact_childs(node_index);
+			}
+		}
+
+		void drop_child_index(Index node_index)
+		{
+			if (!_child_indices.empty())
+			{
+				_child_indices.erase(node_index);
+			}
+		}
+
+		void apply(std::vector<transaction_operation<K, T>>& operations, bool replay = false)
+		{
+			size_t insert_count{ 0 };
+			for (const transaction_operation<K, T>& operation : operations)
+			{
+				insert_count += std::holds_alternative<transaction_insert<K, T>>(operation);
+			}
+			reserve(size() + insert_count);
+
+			std::vector<transaction_operation<K, T>> logged;
+			if (_log)
+			{
+				logged = operations;
+			}
+
+			transaction_journal journal;
+			journal.head_index = _head_index;
+			journal.replay = replay;
+			journal.marks.resize(_nodes.capacity());
+			journal.inserted.reserve(insert_count);
+
+			try
+			{
+				for (transaction_operation<K, T>& operation : operations)
+				{
+					std::visit([&](auto& step) { apply_step(journal, step); }, operation);
+				}
+			}
+			catch (...)
+			{
+				rollback(journal);
+				throw;
+			}
+
+			for (Index parent_index : journal.stale)
+			{
+				if (!(journal.marks[parent_index] & _ERASED))
+				{
+					compact_childs(journal, parent_index);
+				}
+			}
+
+			std::sort(journal.erased.begin(), journal.erased.end());
+			for (Index node_index : journal.erased)
+			{
+				drop_child_index(node_index);
+				_nodes.erase(node_index);
+			}
+
+			size_t new_size{ table_size() };
+			while (new_size > 2 && size() < new_size * MIN_LOAD)
+			{
+				new_size /= 2;
+			}
+
+			if (new_size != table_size())
+			{
+				_nodes.shrink_to_fit();
+				rehash(new_size);
+			}
+
+			for (transaction_operation<K, T>& operation : logged)
+			{
+				_log->append(std::move(operation));
+			}
+		}
+
+		void apply_step(transaction_journal& journal, transaction_insert<K, T>& step)
+		{
+			Index parent_index{ _head_index };
+			if (step.parent)
+			{
+				parent_index = index(*step.parent);
+				if (parent_index == _EMPTY_INDEX)
+				{
+					throw std::out_of_range{ "hash_tree: parent not found" };
+				}
+			}
+
+			if (!journal.replay && index(step.key) != _EMPTY_INDEX)
+			{
+				throw std::invalid_argument{ "hash_tree: duplicate key" };
+			}
+
+			if (parent_index != _EMPTY_INDEX)
+			{
+				save_childs(journal, parent_index);
+			}
+
+			Index _index{ _emplace(std::move(step.key), std::move(step.value)) };
+			journal.inserted.push_back(_index);
+			journal.marks[_index] |= _INSERTED;
+
+			if (parent_index == _EMPTY_INDEX)
+			{
+				_head_index = _index;
 			}
 			else
 			{
-				node_type* it{ &_nodes[_table[map_index]] };
-				while (it->next_index != _EMPTY_INDEX)
+				link_child(parent_index, _index);
+			}
+		}
+
+		void apply_step(transaction_journal& journal, transaction_erase<K>& step)
+		{
+			Index _index{ index(step.key) };
+			if (_index == _EMPTY_INDEX)
+			{
+				throw std::out_of_range{ "hash_tree: key not found" };
+			}
+
+			Index parent_index{ std::as_const(_nodes)[_index].parent_index };
+			if (parent_index != _EMPTY_INDEX && !(journal.marks[parent_index] & _STALE))
+			{
+				journal.stale.push_back(parent_index);
+				journal.marks[parent_index] |= _STALE;
+			}
+
+			size_t first{ journal.erased.size() };
+			journal.erased.push_back(_index);
+			for (size_t i{ first }; i < journal.erased.size(); ++i)
+			{
+				Index node_index{ journal.erased[i] };
+				for (Index child_index : std::as_const(_nodes)[node_index].childs)
+				{
+					if (child_index != _EMPTY_INDEX && !(journal.marks[child_index] & _ERASED))
+					{
+						journal.erased.push_back(child_index);
+					}
+				}
+
+				remove_map(node_index);
+				journal.marks[node_index] |= _ERASED;
+			}
+
+			if (parent_index == _EMPTY_INDEX)
+			{
+				_head_index = _EMPTY_INDEX;
+			}
+		}
+
+		void apply_step(transaction_journal& journal, transaction_set_parent<K>& step)
+		{
+			Index _index{ index(step.key) };
+			Index parent_index{ index(step.parent) };
+			if (_index == _EMPTY_INDEX || parent_index == _EMPTY_INDEX)
+			{
+				throw std::out_of_range{ "hash_tree: key not found" };
+			}
+
+			for (Index it{ parent_index }; it != _EMPTY_INDEX; it = std::as_const(_nodes)[it].parent_index)
+			{
+				if (it == _index)
 				{
-					it = &_nodes[it->next_index];
+					throw std::invalid_argument{ "hash_tree: set_parent would create a cycle" };
 				}
-				it->next_index = node_index;
+			}
+
+			Index old_parent{ std::as_const(_nodes)[_index].parent_index };
+			save_childs(journal, old_parent);
+			save_childs(journal, parent_index);
+			journal.parents.emplace_back(_index, old_parent);
+
+			if ((journal.marks[parent_index] & _STALE) && step.position < std::as_const(_nodes)[parent_index].childs.size())
+			{
+				compact_childs(journal, parent_index);
+			}
+
+			_set_parent(_index, parent_index, step.position);
+		}
+
+		void apply_step(transaction_journal& journal, transaction_assign<K, T>& step)
+		{
+			Index _index{ index(step.key) };
+			if (_index == _EMPTY_INDEX)
+			{
+				throw std::out_of_range{ "hash_tree: key not found" };
+			}
+
+			journal.values.emplace_back(_index, std::move(step.value));
+			std::swap(journal.values.back().second, _nodes[_index].pair.second);
+		}
+
+		void rollback(transaction_journal& journal)
+		{
+			for (auto it{ journal.values.rbegin() }; it != journal.values.rend(); ++it)
+			{
+				std::swap(_nodes[it->first].pair.second, it->second);
+			}
+
+			for (auto it{ journal.parents.rbegin() }; it != journal.parents.rend(); ++it)
+			{
+				_nodes[it->first].parent_index = it->second;
+			}
+
+			for (auto& [node_index, childs] : journal.childs)
+			{
+				_nodes[node_index].childs = std::move(childs);
+				compact_childs(node_index);
+				drop_child_index(node_index);
+			}
+
+			for (Index node_index : journal.erased)
+			{
+				if (journal.marks[node_index] & _ERASED)
+				{
+					insert_map(hash_of(std::as_const(_nodes)[node_index]) % table_size(), node_index);
+					_ordered.insert(std::as_const(_nodes)[node_index].pair.first, node_index);
+				}
+			}
+
+			for (Index node_index : journal.inserted)
+			{
+				remove_map(node_index);
+				drop_child_index(node_index);
+				_nodes.erase(node_index);
+			}
+
+			_head_index = journal.head_index;
+		}
+
+		void log_insert(Index node_index, bool with_parent)
+		{
+			if (_log)
+			{
+				const node_type& node{ std::as_const(_nodes)[node_index] };
+				std::optional<K> parent;
+				if (with_parent)
+				{
+					parent = std::as_const(_nodes)[node.parent_index].pair.first;
+				}
+				_log->append(transaction_insert<K, T>{ node.pair.first, node.pair.second, std::move(parent) });
+			}
+		}
+
+		void log_set_parent(const K& key, const K& new_parent, size_t position)
+		{
+			if (_log)
+			{
+				_log->append(transaction_set_parent<K>{ key, new_parent, position });
+			}
+		}
+
+		void save_childs(transaction_journal& journal, Index node_index)
+		{
+			unsigned char& mark{ journal.marks[node_index] };
+			if (!(mark & (_INSERTED | _SAVED)))
+			{
+				journal.childs.emplace_back(node_index, std::as_const(_nodes)[node_index].childs);
+				mark |= _SAVED;
+			}
+		}
+
+		void compact_childs(Index node_index)
+		{
+			typename node_type::child_container& childs{ _nodes[node_index].childs };
+			childs.erase(std::remove(childs.begin(), childs.end(), _EMPTY_INDEX), childs.end());
+		}
+
+		void compact_childs(const transaction_journal& journal, Index node_index)
+		{
+			typename node_type::child_container& childs{ _nodes[node_index].childs };
+			childs.erase(std::remove_if(childs.begin(), childs.end(), [&](Index child_index)
+				{
+					return child_index == _EMPTY_INDEX || journal.marks[child_index] & _ERASED;
+				}), childs.end());
+			drop_child_index(node_index);
+		}
+
+		void rehash(size_t new_size)
+		{
+			for (node_type& node : _nodes)
+			{
+				node.next_index = _EMPTY_INDEX;
+			}
+
+			_table.assign(new_size, _EMPTY_INDEX);
+			_table.shrink_to_fit();
+			_filter.reset(new_size);
+
+			for (auto it{ _nodes.begin() }; it != _nodes.end(); ++it)
+			{
+				size_t map_index{ hash_of(*it) % table_size() };
+				insert_map(map_index, static_cast<Index>(it.index()));
+			}
+		}
+
+		bool valid_link(Index node_index) const
+		{
+			return node_index == _EMPTY_INDEX || (node_index < _nodes.capacity() && _nodes.test(node_index));
+		}
+
+		bool valid_links(Index head_index) const
+		{
+			if (!valid_link(head_index) || (head_index == _EMPTY_INDEX) != (size() == 0)
+				|| (head_index != _EMPTY_INDEX && _nodes[head_index].parent_index != _EMPTY_INDEX))
+			{
+				return false;
+			}
+
+			for (const node_type& node : std::as_const(_nodes))
+			{
+				if (!valid_link(node.parent_index) || !valid_link(node.next_index))
+				{
+					return false;
+				}
+			}
+
+			std::vector<bool> visited(_nodes.capacity());
+			std::vector<Index> visit;
+			if (head_index != _EMPTY_INDEX)
+			{
+				visited[head_index] = true;
+				visit.push_back(head_index);
+			}
+
+			for (size_t i{ 0 }; i < visit.size(); ++i)
+			{
+				for (Index child_index : _nodes[visit[i]].childs)
+				{
+					if (child_index == _EMPTY_INDEX)
+					{
+						continue;
+					}
+
+					if (!valid_link(child_index) || visited[child_index] || _nodes[child_index].parent_index != visit[i])
+					{
+						return false;
+					}
+
+					visited[child_index] = true;
+					visit.push_back(child_index);
+				}
+			}
+
+			if (visit.size() != size())
+			{
+				return false;
+			}
+
+			size_t steps{ 0 };
+			for (size_t map_index{ 0 }; map_index < _table.size(); ++map_index)
+			{
+				Index node_index{ std::as_const(_table)[map_index] };
+				if (!valid_link(node_index))
+				{
+					return false;
+				}
+
+				for (; node_index != _EMPTY_INDEX; node_index = _nodes[node_index].next_index)
+				{
+					if (++steps > size())
+					{
+						return false;
+					}
+				}
+			}
+
+			return steps == size();
+		}
+
+		void rebuild_filter()
+		{
+			_filter.reset(table_size());
+			for (const node_type& node : std::as_const(_nodes))
+			{
+				_filter.add(hash_of(node));
+			}
+		}
+
+		void insert_map(size_t map_index, Index node_index)
+		{
+			_filter.add(hash_of(std::as_const(_nodes)[node_index]));
+			chain::link(_nodes, _table, map_index, node_index);
+		}
+
+		void remove_map(Index node_index)
+		{
+			size_t map_index{ hash_of(std::as_const(_nodes)[node_index]) % table_size() };
+			chain::unlink(_nodes, _table, map_index, node_index);
+
+			const node_type& node{ std::as_const(_nodes)[node_index] };
+			_ordered.erase(node.pair.first);
+			_filter.remove(hash_of(node));
+			if (_filter.stale())
+			{
+				rebuild_filter();
 			}
 		}
 	};
 
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t>
+	using cow_hash_tree = hash_tree<K, T, Hasher, Keyeq, Index, cow_hash_tree_storage>;
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t>
+	using tracked_hash_tree = hash_tree<K, T, Hasher, Keyeq, Index, tracked_hash_tree_storage>;
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t>
+	using filtered_hash_tree = hash_tree<K, T, Hasher, Keyeq, Index, filtered_hash_tree_storage>;
+
+	template<
+		typename K,
+		typename T,
+		typename Compare = std::less<>,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t>
+	using sorted_hash_tree = hash_tree<K, T, Hasher, Keyeq, Index, sorted_hash_tree_storage<Compare>>;
+
+	template<
+		typename K,
+		typename T,
+		typename Compare = std::less<>,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t>
+	using ordered_hash_tree = hash_tree<K, T, Hasher, Keyeq, Index, ordered_hash_tree_storage<Compare>>;
+
 }
 
 #endif
@@ -0,0 +1,439 @@
+#ifndef BYTE_HASHTREEBTREE_H
+#define BYTE_HASHTREEBTREE_H
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	template<typename K, typename Index>
+	struct no_ordered_index
+	{
+		inline static constexpr bool enabled{ false };
+
+		void insert(const K&, Index)
+		{
+		}
+
+		void erase(const K&)
+		{
+		}
+
+		template<typename Key, typename Function>
+		void scan(const Key&, Function&&) const
+		{
+		}
+
+		template<typename Key, typename Upper, typename Function>
+		void scan(const Key&, const Upper&, Function&&) const
+		{
+		}
+
+		void clear()
+		{
+		}
+	};
+
+	template<typename K, typename Index, typename Compare = std::less<>>
+	class btree_index
+	{
+	private:
+		inline static constexpr size_t NODE_BYTES{ 256 };
+		inline static constexpr size_t ORDER{ std::max<size_t>(4, NODE_BYTES / (sizeof(K) + sizeof(Index))) };
+
+		struct node
+		{
+			bool leaf;
+			size_t count{ 0 };
+			std::array<K, ORDER> keys{};
+		};
+
+		struct leaf_node : node
+		{
+			std::array<Index, ORDER> values{};
+			leaf_node* next{ nullptr };
+		};
+
+		struct inner_node : node
+		{
+			std::array<node*, ORDER + 1> childs{};
+		};
+
+		struct split_result
+		{
+			K key;
+			node* right;
+		};
+
+		node* _root{ nullptr };
+		size_t _size{ 0 };
+		size_t _erased{ 0 };
+		Compare _compare;
+
+	public:
+		inline static constexpr bool enabled{ true };
+
+		btree_index() = default;
+
+		btree_index(const btree_index& left)
+			:_compare{ left._compare }
+		{
+			std::vector<std::pair<K, Index>> entries;
+			left.collect(entries);
+			build(entries);
+		}
+
+		btree_index(btree_index&& right) noexcept
+			:_root{ std::exchange(right._root, nullptr) },
+			_size{ std::exchange(right._size, 0) },
+			_erased{ std::exchange(right._erased, 0) },
+			_compare{ std::move(right._compare) }
+		{
+		}
+
+		btree_index& operator=(const btree_index& left)
+		{
+			if (this != &left)
+			{
+				btree_index copy{ left };
+				*this = std::move(copy);
+			}
+
+			return *this;
+		}
+
+		btree_index& operator=(btree_index&& right) noexcept
+		{
+			if (this != &right)
+			{
+				clear();
+				_root = std::exchange(right._root, nullptr);
+				_size = std::exchange(right._size, 0);
+				_erased = std::exchange(right._erased, 0);
+				_compare = std::move(right._compare);
+			}
+
+			return *this;
+		}
+
+		~btree_index()
+		{
+			clear();
+		}
+
+		void insert(const K& key, Index value)
+		{
+			if (!_root)
+			{
+				_root = new leaf_node{ { true } };
+			}
+
+			std::optional<split_result> split{ insert(_root, key, value) };
+			if (split)
+			{
+				inner_node* root{ new inner_node{ { false } } };
+				root->count = 1;
+				root->keys[0] = std::move(split->key);
+				root->childs[0] = _root;
+				root->childs[1] = split->right;
+				_root = root;
+			}
+		}
+
+		void erase(const K& key)
+		{
+			if (!_root)
+			{
+				return;
+			}
+
+			leaf_node* leaf{ find_leaf(key) };
+			size_t position{ lower_position(*leaf, key) };
+			if (position == leaf->count || _compare(key, leaf->keys[position]))
+			{
+				return;
+			}
+
+			std::move(leaf->keys.begin() + position + 1, leaf->keys.begin() + leaf->count, leaf->keys.begin() + position);
+			std::move(leaf->values.begin() + position + 1, leaf->values.begin() + leaf->count, leaf->values.begin() + position);
+			--leaf->count;
+			--_size;
+
+			if (++_erased > _size + ORDER)
+			{
+				std::vector<std::pair<K, Index>> entries;
+				collect(entries);
+				clear();
+				build(entries);
+			}
+		}
+
+		template<typename Key, typename Function>
+		void scan(const Key& lower, Function&& function) const
+		{
+			if (!_root)
+			{
+				return;
+			}
+
+			const leaf_node* leaf{ find_leaf(lower) };
+			for (size_t position{ lower_position(*leaf, lower) }; leaf; leaf = leaf->next, position = 0)
+			{
+				for (; position < leaf->count; ++position)
+				{
+					if (!function(leaf->keys[position], leaf->values[position]))
+					{
+						return;
+					}
+				}
+			}
+		}
+
+		template<typename Key, typename Upper, typename Function>
+		void scan(const Key& lower, const Upper& upper, Function&& function) const
+		{
+			scan(lower, [&](const K& key, Index value)
+				{
+					return _compare(key, upper) && function(key, value);
+				});
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+
+		void clear()
+		{
+			destroy(_root);
+			_root = nullptr;
+			_size = 0;
+			_erased = 0;
+		}
+
+	private:
+		template<typename Key>
+		size_t lower_position(const node& target, const Key& key) const
+		{
+			return std::lower_bound(target.keys.begin(), target.keys.begin() + target.count, key, _compare) - target.keys.begin();
+		}
+
+		template<typename Key>
+		size_t upper_position(const node& target, const Key& key) const
+		{
+			return std::upper_bound(target.keys.begin(), target.keys.begin() + target.count, key, _compare) - target.keys.begin();
+		}
+
+		template<typename Key>
+		leaf_node* find_leaf(const Key& key) const
+		{
+			node* it{ _root };
+			while (!it->leaf)
+			{
+				it = static_cast<inner_node*>(it)->childs[upper_position(*it, key)];
+			}
+
+			return static_cast<leaf_node*>(it);
+		}
+
+		std::optional<split_result> insert(node* target, const K& key, Index value)
+		{
+			if (target->leaf)
+			{
+				leaf_node* leaf{ static_cast<leaf_node*>(target) };
+				size_t position{ lower_position(*leaf, key) };
+				if (position != leaf->count && !_compare(key, leaf->keys[position]))
+				{
+					leaf->values[position] = value;
+					return std::nullopt;
+				}
+
+				++_size;
+				if (leaf->count == ORDER)
+				{
+					leaf_node* right{ new leaf_node{ { true } } };
+					size_t middle{ ORDER / 2 };
+					right->count = ORDER - middle;
+					std::move(leaf->keys.begin() + middle, leaf->keys.end(), right->keys.begin());
+					std::move(leaf->values.begin() + middle, leaf->values.end(), right->values.begin());
+					leaf->count = middle;
+					right->next = leaf->next;
+					leaf->next = right;
+
+					if (position <= middle)
+					{
+						insert_entry(*leaf, position, key, value);
+					}
+					else
+					{
+						insert_entry(*right, position - middle, key, value);
+					}
+
+					return split_result{ right->keys[0], right };
+				}
+
+				insert_entry(*leaf, position, key, value);
+				return std::nullopt;
+			}
+
+			inner_node* inner{ static_cast<inner_node*>(target) };
+			size_t position{ upper_position(*inner, key) };
+			std::optional<split_result> split{ insert(inner->childs[position], key, value) };
+			if (!split)
+			{
+				return std::nullopt;
+			}
+
+			if (inner->count < ORDER)
+			{
+				insert_child(*inner, position, std::move(split->key), split->right);
+				return std::nullopt;
+			}
+
+			inner_node* right{ new inner_node{ { false } } };
+			size_t middle{ ORDER / 2 };
+			K separator{ std::move(inner->keys[middle]) };
+			right->count = ORDER - middle - 1;
+			std::move(inner->keys.begin() + middle + 1, inner->keys.end(), right->keys.begin());
+			std::copy(inner->childs.begin() + middle + 1, inner->childs.end(), right->childs.begin());
+			inner->count = middle;
+
+			if (position <= middle)
+			{
+				insert_child(*inner, position, std::move(split->key), split->right);
+			}
+			else
+			{
+				insert_child(*right, position - middle - 1, std::move(split->key), split->right);
+			}
+
+			return split_result{ std::move(separator), right };
+		}
+
+		static void insert_entry(leaf_node& leaf, size_t position, const K& key, Index value)
+		{
+			std::move_backward(leaf.keys.begin() + position, leaf.keys.begin() + leaf.count, leaf.keys.begin() + leaf.count + 1);
+			std::move_backward(leaf.values.begin() + position, leaf.values.begin() + leaf.count, leaf.values.begin() + leaf.count + 1);
+			leaf.keys[position] = key;
+			leaf.values[position] = value;
+			++leaf.count;
+		}
+
+		static void insert_child(inner_node& inner, size_t position, K&& key, node* child)
+		{
+			std::move_backward(inner.keys.begin() + position, inner.keys.begin() + inner.count, inner.keys.begin() + inner.count + 1);
+			std::copy_backward(inner.childs.begin() + position + 1, inner.childs.begin() + inner.count + 1, inner.childs.begin() + inner.count + 2);
+			inner.keys[position] = std::move(key);
+			inner.childs[position + 1] = child;
+			++inner.count;
+		}
+
+		void collect(std::vector<std::pair<K, Index>>& entries) const
+		{
+			entries.reserve(_size);
+			if (!_root)
+			{
+				return;
+			}
+
+			const node* it{ _root };
+			while (!it->leaf)
+			{
+				it = static_cast<const inner_node*>(it)->childs[0];
+			}
+
+			for (const leaf_node* leaf{ static_cast<const leaf_node*>(it) }; leaf; leaf = leaf->next)
+			{
+				for (size_t position{ 0 }; position < leaf->count; ++position)
+				{
+					entries.emplace_back(leaf->keys[position], leaf->values[position]);
+				}
+			}
+		}
+
+		void build(const std::vector<std::pair<K, Index>>& entries)
+		{
+			if (entries.empty())
+			{
+				return;
+			}
+
+			std::vector<std::pair<K, node*>> level;
+			leaf_node* previous{ nullptr };
+			for (size_t first{ 0 }; first < entries.size(); first += ORDER - 1)
+			{
+				leaf_node* leaf{ new leaf_node{ { true } } };
+				leaf->count = std::min(ORDER - 1, entries.size() - first);
+				for (size_t position{ 0 }; position < leaf->count; ++position)
+				{
+					leaf->keys[position] = entries[first + position].first;
+					leaf->values[position] = entries[first + position].second;
+				}
+
+				if (previous)
+				{
+					previous->next = leaf;
+				}
+				previous = leaf;
+				level.emplace_back(leaf->keys[0], leaf);
+			}
+
+			while (level.size() > 1)
+			{
+				std::vector<std::pair<K, node*>> parents;
+				for (size_t first{ 0 }; first < level.size(); first += ORDER)
+				{
+					size_t last{ std::min(first + ORDER, level.size()) };
+					if (last - first == 1)
+					{
+						inner_node& sibling{ *static_cast<inner_node*>(parents.back().second) };
+						insert_child(sibling, sibling.count, K{ level[first].first }, level[first].second);
+						break;
+					}
+
+					inner_node* inner{ new inner_node{ { false } } };
+					inner->childs[0] = level[first].second;
+					for (size_t i{ first + 1 }; i < last; ++i)
+					{
+						inner->keys[inner->count] = level[i].first;
+						inner->childs[++inner->count] = level[i].second;
+					}
+					parents.emplace_back(level[first].first, inner);
+				}
+				level = std::move(parents);
+			}
+
+			_root = level.front().second;
+			_size = entries.size();
+		}
+
+		static void destroy(node* target)
+		{
+			if (!target)
+			{
+				return;
+			}
+
+			if (target->leaf)
+			{
+				delete static_cast<leaf_node*>(target);
+				return;
+			}
+
+			inner_node* inner{ static_cast<inner_node*>(target) };
+			for (size_t i{ 0 }; i <= inner->count; ++i)
+			{
+				destroy(inner->childs[i]);
+			}
+			delete inner;
+		}
+	};
+
+}
+
+#endif
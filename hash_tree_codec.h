@@ -0,0 +1,226 @@
+#ifndef BYTE_HASHTREE_CODEC_H
+#define BYTE_HASHTREE_CODEC_H
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <array>
+#include <type_traits>
+
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#define BYTE_HAS_FD_STREAMBUF
+#endif
+
+namespace Byte
+{
+
+	inline constexpr size_t _CODEC_CHUNK{ 1ULL << 16 };
+
+	inline void write_varint(std::ostream& out, size_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.put(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		out.put(static_cast<char>(value));
+	}
+
+	inline size_t read_varint(std::istream& in)
+	{
+		size_t value{ 0 };
+		for (size_t shift{ 0 }; shift < 64; shift += 7)
+		{
+			std::istream::int_type byte{ in.get() };
+			if (byte == std::istream::traits_type::eof())
+			{
+				return 0;
+			}
+
+			value |= static_cast<size_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				break;
+			}
+		}
+
+		return value;
+	}
+
+	template<typename T, typename = void>
+	struct codec;
+
+	template<typename T>
+	struct codec<T, std::enable_if_t<std::is_trivially_copyable<T>::value>>
+	{
+		void write(std::ostream& out, const T& value) const
+		{
+			out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		T read(std::istream& in) const
+		{
+			T value{};
+			in.read(reinterpret_cast<char*>(&value), sizeof(T));
+			return value;
+		}
+	};
+
+	template<typename C, typename Traits, typename Allocator>
+	struct codec<std::basic_string<C, Traits, Allocator>>
+	{
+		using string_type = std::basic_string<C, Traits, Allocator>;
+
+		void write(std::ostream& out, const string_type& value) const
+		{
+			write_varint(out, value.size());
+			out.write(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(C));
+		}
+
+		string_type read(std::istream& in) const
+		{
+			string_type value;
+			size_t length{ read_varint(in) };
+			while (in && value.size() < length)
+			{
+				size_t offset{ value.size() };
+				value.resize(offset + std::min(length - offset, _CODEC_CHUNK));
+				in.read(reinterpret_cast<char*>(value.data() + offset), (value.size() - offset) * sizeof(C));
+			}
+			return value;
+		}
+	};
+
+	template<typename U, typename Allocator>
+	struct codec<std::vector<U, Allocator>>
+	{
+		using vector_type = std::vector<U, Allocator>;
+
+		codec<U> element_codec;
+
+		void write(std::ostream& out, const vector_type& value) const
+		{
+			write_varint(out, value.size());
+			for (const U& item : value)
+			{
+				element_codec.write(out, item);
+			}
+		}
+
+		vector_type read(std::istream& in) const
+		{
+			vector_type value;
+			size_t count{ read_varint(in) };
+			value.reserve(std::min(count, _CODEC_CHUNK));
+			for (size_t index{ 0 }; index < count && in; ++index)
+			{
+				value.push_back(element_codec.read(in));
+			}
+			return value;
+		}
+	};
+
+	class memory_streambuf : public std::streambuf
+	{
+	public:
+		memory_streambuf(const char* data, size_t size)
+		{
+			char* begin{ const_cast<char*>(data) };
+			setg(begin, begin, begin + size);
+		}
+	};
+
+#ifdef BYTE_HAS_FD_STREAMBUF
+
+	template<size_t BufferSize = 1ULL << 16>
+	class fd_streambuf : public std::streambuf
+	{
+	private:
+		int _fd;
+		std::array<char, BufferSize> _input;
+		std::array<char, BufferSize> _output;
+
+	public:
+		explicit fd_streambuf(int fd)
+			:_fd{ fd }
+		{
+			setg(_input.data(), _input.data(), _input.data());
+			setp(_output.data(), _output.data() + _output.size());
+		}
+
+		fd_streambuf(const fd_streambuf& left) = delete;
+
+		fd_streambuf& operator=(const fd_streambuf& left) = delete;
+
+		~fd_streambuf() override
+		{
+			sync();
+		}
+
+	protected:
+		int_type underflow() override
+		{
+			if (gptr() < egptr())
+			{
+				return traits_type::to_int_type(*gptr());
+			}
+
+			ssize_t count{ ::read(_fd, _input.data(), _input.size()) };
+			if (count <= 0)
+			{
+				return traits_type::eof();
+			}
+
+			setg(_input.data(), _input.data(), _input.data() + count);
+			return traits_type::to_int_type(*gptr());
+		}
+
+		int_type overflow(int_type value) override
+		{
+			if (flush() != 0)
+			{
+				return traits_type::eof();
+			}
+
+			if (!traits_type::eq_int_type(value, traits_type::eof()))
+			{
+				*pptr() = traits_type::to_char_type(value);
+				pbump(1);
+			}
+
+			return traits_type::not_eof(value);
+		}
+
+		int sync() override
+		{
+			return flush();
+		}
+
+	private:
+		int flush()
+		{
+			const char* it{ pbase() };
+			while (it < pptr())
+			{
+				ssize_t count{ ::write(_fd, it, pptr() - it) };
+				if (count <= 0)
+				{
+					return -1;
+				}
+				it += count;
+			}
+
+			setp(_output.data(), _output.data() + _output.size());
+			return 0;
+		}
+	};
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef BYTE_HASHTREEFILTER_H
+#define BYTE_HASHTREEFILTER_H
+
+#include "hash_tree_hash.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace Byte
+{
+
+	struct no_hash_filter
+	{
+		void reset(size_t)
+		{
+		}
+
+		void add(size_t)
+		{
+		}
+
+		void remove(size_t)
+		{
+		}
+
+		bool may_contain(size_t) const
+		{
+			return true;
+		}
+
+		bool stale() const
+		{
+			return false;
+		}
+	};
+
+	class blocked_bloom_filter
+	{
+	private:
+		inline static constexpr size_t WORD_COUNT{ 8 };
+		inline static constexpr size_t BLOCK_BITS{ WORD_COUNT * 64 };
+		inline static constexpr size_t BITS_PER_KEY{ 10 };
+		inline static constexpr size_t PROBES{ 6 };
+		inline static constexpr size_t PROBE_BITS{ 9 };
+
+		struct alignas(64) block
+		{
+			std::array<uint64_t, WORD_COUNT> words{};
+		};
+
+		std::vector<block> _blocks{ 1 };
+		size_t _mask{ 0 };
+		size_t _added{ 0 };
+		size_t _removed{ 0 };
+
+	public:
+		void reset(size_t expected)
+		{
+			size_t block_count{ std::bit_ceil((expected * BITS_PER_KEY + BLOCK_BITS - 1) / BLOCK_BITS) };
+			_blocks.assign(block_count == 0 ? 1 : block_count, block{});
+			_mask = _blocks.size() - 1;
+			_added = 0;
+			_removed = 0;
+		}
+
+		void add(size_t hash_value)
+		{
+			size_t probe{ _mix_hash(hash_value) };
+			block& target{ _blocks[(probe * 0x9E3779B97F4A7C15ULL >> 32) & _mask] };
+			for (size_t i{ 0 }; i < PROBES; ++i)
+			{
+				size_t bit{ probe >> (i * PROBE_BITS) & (BLOCK_BITS - 1) };
+				target.words[bit / 64] |= 1ULL << (bit % 64);
+			}
+			++_added;
+		}
+
+		void remove(size_t)
+		{
+			++_removed;
+		}
+
+		bool may_contain(size_t hash_value) const
+		{
+			size_t probe{ _mix_hash(hash_value) };
+			const block& target{ _blocks[(probe * 0x9E3779B97F4A7C15ULL >> 32) & _mask] };
+			for (size_t i{ 0 }; i < PROBES; ++i)
+			{
+				size_t bit{ probe >> (i * PROBE_BITS) & (BLOCK_BITS - 1) };
+				if (!(target.words[bit / 64] >> (bit % 64) & 1))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool stale() const
+		{
+			return _removed > _added / 2 + BLOCK_BITS / BITS_PER_KEY;
+		}
+	};
+
+}
+
+#endif
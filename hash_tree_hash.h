@@ -0,0 +1,103 @@
+#ifndef BYTE_HASHTREE_HASH_H
+#define BYTE_HASHTREE_HASH_H
+
+#include <string_view>
+#include <functional>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+namespace Byte
+{
+
+	inline constexpr size_t _mix_hash(size_t value)
+	{
+		value ^= value >> 30;
+		value *= 0xBF58476D1CE4E5B9ULL;
+		value ^= value >> 27;
+		value *= 0x94D049BB133111EBULL;
+		value ^= value >> 31;
+		return value;
+	}
+
+	inline constexpr size_t _mix_hash(size_t value, size_t seed)
+	{
+		return _mix_hash(value + (seed + 1) * 0x9E3779B97F4A7C15ULL);
+	}
+
+	template<typename K>
+	struct integer_hash
+	{
+		size_t operator()(K key) const
+		{
+			return _mix_hash(static_cast<size_t>(key));
+		}
+	};
+
+	template<typename K>
+	using default_hash = std::conditional_t<std::is_integral<K>::value, integer_hash<K>, std::hash<K>>;
+
+	template<typename K, typename = void>
+	struct static_hash;
+
+	template<typename K>
+	struct static_hash<K, std::enable_if_t<std::is_integral<K>::value || std::is_enum<K>::value>>
+	{
+		constexpr size_t operator()(K key) const
+		{
+			return _mix_hash(static_cast<size_t>(key));
+		}
+	};
+
+	template<typename C, typename Traits>
+	struct static_hash<std::basic_string_view<C, Traits>>
+	{
+		constexpr size_t operator()(std::basic_string_view<C, Traits> key) const
+		{
+			size_t value{ 0xCBF29CE484222325ULL };
+			for (C c : key)
+			{
+				value ^= static_cast<size_t>(c);
+				value *= 0x100000001B3ULL;
+			}
+			return _mix_hash(value);
+		}
+	};
+
+	template<typename K>
+	struct stores_key_hash : std::bool_constant<!std::is_integral<K>::value>
+	{
+	};
+
+	template<typename K>
+	struct key_fingerprint
+	{
+		inline static constexpr bool enabled{ false };
+	};
+
+	template<typename C, typename Traits>
+	struct key_fingerprint<std::basic_string_view<C, Traits>>
+	{
+		inline static constexpr bool enabled{ sizeof(C) == 1 && std::is_same<Traits, std::char_traits<C>>::value };
+		inline static constexpr size_t INLINE_SIZE{ 7 };
+
+		static uint64_t make(std::basic_string_view<C, Traits> key)
+		{
+			uint64_t value{ std::min<uint64_t>(key.size(), 0xFF) << 56 };
+			for (size_t i{ 0 }; i < key.size() && i < INLINE_SIZE; ++i)
+			{
+				value |= static_cast<uint64_t>(static_cast<unsigned char>(key[i])) << (i * 8);
+			}
+			return value;
+		}
+
+		static bool exact(uint64_t value)
+		{
+			return value >> 56 <= INLINE_SIZE;
+		}
+	};
+
+}
+
+#endif
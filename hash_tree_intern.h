@@ -0,0 +1,220 @@
+#ifndef BYTE_HASHTREEINTERN_H
+#define BYTE_HASHTREEINTERN_H
+
+#include "hash_tree.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace Byte
+{
+
+	class interned_string
+	{
+	private:
+		const char* _data{ nullptr };
+		uint32_t _size{ 0 };
+		uint32_t _hash{ 0 };
+
+		friend class string_arena;
+
+		interned_string(const char* data, uint32_t size, uint32_t hash)
+			:_data{ data }, _size{ size }, _hash{ hash }
+		{
+		}
+
+	public:
+		interned_string() = default;
+
+		const char* data() const
+		{
+			return _data;
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+
+		bool empty() const
+		{
+			return _size == 0;
+		}
+
+		uint32_t hash() const
+		{
+			return _hash;
+		}
+
+		std::string_view view() const
+		{
+			return std::string_view{ _data, _size };
+		}
+
+		operator std::string_view() const
+		{
+			return view();
+		}
+
+		bool operator==(const interned_string& left) const
+		{
+			return _data == left._data;
+		}
+
+		bool operator!=(const interned_string& left) const
+		{
+			return _data != left._data;
+		}
+	};
+
+	template<>
+	struct stores_key_hash<interned_string> : std::false_type
+	{
+	};
+
+	class string_arena
+	{
+	private:
+		inline static constexpr size_t CHUNK_SIZE{ 64 * 1024 };
+
+		struct view_hash
+		{
+			size_t operator()(std::string_view value) const
+			{
+				return std::hash<std::string_view>{}(value);
+			}
+		};
+
+		std::vector<std::unique_ptr<char[]>> _chunks;
+		char* _chunk{ nullptr };
+		size_t _used{ CHUNK_SIZE };
+		size_t _bytes{ 0 };
+		std::unordered_set<std::string_view, view_hash> _strings;
+
+	public:
+		string_arena() = default;
+
+		string_arena(const string_arena&) = delete;
+
+		string_arena(string_arena&&) noexcept = default;
+
+		string_arena& operator=(const string_arena&) = delete;
+
+		string_arena& operator=(string_arena&&) noexcept = default;
+
+		interned_string intern(std::string_view value)
+		{
+			auto it{ _strings.find(value) };
+			if (it == _strings.end())
+			{
+				it = _strings.insert(std::string_view{ allocate(value), value.size() }).first;
+			}
+
+			return make(*it);
+		}
+
+		interned_string find(std::string_view value) const
+		{
+			auto it{ _strings.find(value) };
+			if (it == _strings.end())
+			{
+				return interned_string{};
+			}
+
+			return make(*it);
+		}
+
+		size_t size() const
+		{
+			return _strings.size();
+		}
+
+		size_t bytes() const
+		{
+			return _bytes;
+		}
+
+		void clear()
+		{
+			_strings.clear();
+			_chunks.clear();
+			_chunk = nullptr;
+			_used = CHUNK_SIZE;
+			_bytes = 0;
+		}
+
+	private:
+		static interned_string make(std::string_view value)
+		{
+			return interned_string{ value.data(), static_cast<uint32_t>(value.size()), static_cast<uint32_t>(view_hash{}(value)) };
+		}
+
+		const char* allocate(std::string_view value)
+		{
+			_bytes += value.size();
+			if (value.size() > CHUNK_SIZE / 4)
+			{
+				_chunks.push_back(std::make_unique<char[]>(value.size()));
+				std::memcpy(_chunks.back().get(), value.data(), value.size());
+				return _chunks.back().get();
+			}
+
+			size_t length{ std::max<size_t>(value.size(), 1) };
+			if (CHUNK_SIZE - _used < length)
+			{
+				_chunks.push_back(std::make_unique<char[]>(CHUNK_SIZE));
+				_chunk = _chunks.back().get();
+				_used = 0;
+			}
+
+			char* data{ _chunk + _used };
+			std::memcpy(data, value.data(), value.size());
+			_used += length;
+			return data;
+		}
+	};
+
+	struct interned_hash
+	{
+		size_t operator()(interned_string key) const
+		{
+			return _mix_hash(key.hash());
+		}
+	};
+
+	template<>
+	struct codec<interned_string>;
+
+	struct interned_codec
+	{
+		string_arena* arena;
+
+		void write(std::ostream& out, interned_string value) const
+		{
+			write_varint(out, value.size());
+			out.write(value.data(), value.size());
+		}
+
+		interned_string read(std::istream& in) const
+		{
+			return arena->intern(codec<std::string>{}.read(in));
+		}
+	};
+
+	template<
+		typename T,
+		typename Index = size_t,
+		typename Storage = hash_tree_storage>
+	using interned_hash_tree = hash_tree<interned_string, T, interned_hash, std::equal_to<interned_string>, Index, Storage>;
+
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef BYTE_HASHTREE_LOG_H
+#define BYTE_HASHTREE_LOG_H
+
+#include "hash_tree_codec.h"
+#include "hash_tree_transaction.h"
+
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+namespace Byte
+{
+
+	using log_sequence = uint64_t;
+
+	template<typename K, typename T>
+	class change_log
+	{
+	public:
+		using record_type = transaction_operation<K, T>;
+
+	private:
+		std::deque<record_type> _records;
+		size_t _capacity;
+		log_sequence _first_sequence{ 0 };
+
+	public:
+		explicit change_log(size_t capacity = std::numeric_limits<size_t>::max())
+			:_capacity{ capacity }
+		{
+		}
+
+		void append(record_type&& record)
+		{
+			if (_capacity == 0)
+			{
+				++_first_sequence;
+				return;
+			}
+
+			if (_records.size() == _capacity)
+			{
+				_records.pop_front();
+				++_first_sequence;
+			}
+
+			_records.push_back(std::move(record));
+		}
+
+		const record_type& at(log_sequence sequence) const
+		{
+			if (sequence < _first_sequence || sequence >= next_sequence())
+			{
+				throw std::out_of_range{ "change_log: sequence is not retained" };
+			}
+
+			return _records[sequence - _first_sequence];
+		}
+
+		void trim(log_sequence sequence)
+		{
+			while (!_records.empty() && _first_sequence < sequence)
+			{
+				_records.pop_front();
+				++_first_sequence;
+			}
+		}
+
+		log_sequence first_sequence() const
+		{
+			return _first_sequence;
+		}
+
+		log_sequence next_sequence() const
+		{
+			return _first_sequence + _records.size();
+		}
+
+		size_t size() const
+		{
+			return _records.size();
+		}
+
+		size_t capacity() const
+		{
+			return _capacity;
+		}
+
+		bool empty() const
+		{
+			return _records.empty();
+		}
+
+		void clear()
+		{
+			_first_sequence = next_sequence();
+			_records.clear();
+		}
+
+		void restart(log_sequence sequence)
+		{
+			_first_sequence = sequence;
+			_records.clear();
+		}
+
+		template<typename KeyCodec = codec<K>, typename ValueCodec = codec<T>>
+		void write(std::ostream& out, log_sequence from, const KeyCodec& key_codec = {}, const ValueCodec& value_codec = {}) const
+		{
+			if (from < _first_sequence)
+			{
+				throw std::out_of_range{ "change_log: sequence is not retained" };
+			}
+
+			if (from > next_sequence())
+			{
+				throw std::out_of_range{ "change_log: sequence has not been written yet" };
+			}
+
+			write_varint(out, from);
+			write_varint(out, next_sequence() - from);
+			for (log_sequence sequence{ from }; sequence < next_sequence() && out; ++sequence)
+			{
+				const record_type& record{ _records[sequence - _first_sequence] };
+				out.put(static_cast<char>(record.index()));
+				std::visit([&](const auto& step) { write_record(out, step, key_codec, value_codec); }, record);
+			}
+		}
+
+		template<typename KeyCodec = codec<K>, typename ValueCodec = codec<T>>
+		void read(std::istream& in, const KeyCodec& key_codec = {}, const ValueCodec& value_codec = {})
+		{
+			log_sequence from{ read_varint(in) };
+			size_t count{ read_varint(in) };
+			if (!in)
+			{
+				return;
+			}
+
+			if (empty())
+			{
+				_first_sequence = from;
+			}
+			else if (from != next_sequence())
+			{
+				in.setstate(std::ios::failbit);
+				return;
+			}
+
+			for (size_t i{ 0 }; i < count; ++i)
+			{
+				std::istream::int_type opcode{ in.get() };
+				K key{ key_codec.read(in) };
+				record_type record{ read_record(in, opcode, std::move(key), key_codec, value_codec) };
+
+				if (!in)
+				{
+					return;
+				}
+
+				append(std::move(record));
+			}
+		}
+
+	private:
+		template<typename KeyCodec, typename ValueCodec>
+		static record_type read_record(std::istream& in, std::istream::int_type opcode, K&& key, const KeyCodec& key_codec, const ValueCodec& value_codec)
+		{
+			switch (opcode)
+			{
+			case 0:
+			{
+				std::optional<K> parent;
+				if (in.get() == 1)
+				{
+					parent = key_codec.read(in);
+				}
+				T value{ value_codec.read(in) };
+				return transaction_insert<K, T>{ std::move(key), std::move(value), std::move(parent) };
+			}
+			case 1:
+				return transaction_erase<K>{ std::move(key) };
+			case 2:
+			{
+				K parent{ key_codec.read(in) };
+				size_t position{ read_varint(in) };
+				return transaction_set_parent<K>{ std::move(key), std::move(parent), position == 0 ? std::numeric_limits<size_t>::max() : position - 1 };
+			}
+			case 3:
+				return transaction_assign<K, T>{ std::move(key), value_codec.read(in) };
+			default:
+				in.setstate(std::ios::failbit);
+				return transaction_erase<K>{ std::move(key) };
+			}
+		}
+
+		template<typename KeyCodec, typename ValueCodec>
+		static void write_record(std::ostream& out, const transaction_insert<K, T>& step, const KeyCodec& key_codec, const ValueCodec& value_codec)
+		{
+			key_codec.write(out, step.key);
+			out.put(static_cast<char>(step.parent.has_value()));
+			if (step.parent)
+			{
+				key_codec.write(out, *step.parent);
+			}
+			value_codec.write(out, step.value);
+		}
+
+		template<typename KeyCodec, typename ValueCodec>
+		static void write_record(std::ostream& out, const transaction_erase<K>& step, const KeyCodec& key_codec, const ValueCodec&)
+		{
+			key_codec.write(out, step.key);
+		}
+
+		template<typename KeyCodec, typename ValueCodec>
+		static void write_record(std::ostream& out, const transaction_set_parent<K>& step, const KeyCodec& key_codec, const ValueCodec&)
+		{
+			key_codec.write(out, step.key);
+			key_codec.write(out, step.parent);
+			write_varint(out, step.position == std::numeric_limits<size_t>::max() ? 0 : step.position + 1);
+		}
+
+		template<typename KeyCodec, typename ValueCodec>
+		static void write_record(std::ostream& out, const transaction_assign<K, T>& step, const KeyCodec& key_codec, const ValueCodec& value_codec)
+		{
+			key_codec.write(out, step.key);
+			value_codec.write(out, step.value);
+		}
+	};
+
+}
+
+#endif
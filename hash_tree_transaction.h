@@ -0,0 +1,144 @@
+#ifndef BYTE_HASHTREE_TRANSACTION_H
+#define BYTE_HASHTREE_TRANSACTION_H
+
+#include <limits>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace Byte
+{
+
+	template<typename K, typename T>
+	struct transaction_insert
+	{
+		K key;
+		T value;
+		std::optional<K> parent;
+	};
+
+	template<typename K>
+	struct transaction_erase
+	{
+		K key;
+	};
+
+	template<typename K>
+	struct transaction_set_parent
+	{
+		K key;
+		K parent;
+		size_t position;
+	};
+
+	template<typename K, typename T>
+	struct transaction_assign
+	{
+		K key;
+		T value;
+	};
+
+	template<typename K, typename T>
+	using transaction_operation = std::variant<
+		transaction_insert<K, T>,
+		transaction_erase<K>,
+		transaction_set_parent<K>,
+		transaction_assign<K, T>>;
+
+	template<typename Tree>
+	class hash_tree_transaction
+	{
+	private:
+		using K = typename Tree::key_type;
+		using T = typename Tree::mapped_type;
+
+	public:
+		using operation = transaction_operation<K, T>;
+
+	private:
+		Tree* _tree;
+		std::vector<operation> _operations;
+
+	public:
+		explicit hash_tree_transaction(Tree* tree)
+			:_tree{ tree }
+		{
+		}
+
+		void insert(const K& key, const T& value)
+		{
+			_operations.emplace_back(transaction_insert<K, T>{ key, value, std::nullopt });
+		}
+
+		void insert(K&& key, T&& value)
+		{
+			_operations.emplace_back(transaction_insert<K, T>{ std::move(key), std::move(value), std::nullopt });
+		}
+
+		void insert(const K& key, const T& value, const K& parent)
+		{
+			_operations.emplace_back(transaction_insert<K, T>{ key, value, parent });
+		}
+
+		void insert(K&& key, T&& value, const K& parent)
+		{
+			_operations.emplace_back(transaction_insert<K, T>{ std::move(key), std::move(value), parent });
+		}
+
+		void erase(const K& key)
+		{
+			_operations.emplace_back(transaction_erase<K>{ key });
+		}
+
+		void set_parent(const K& key, const K& new_parent)
+		{
+			set_parent(key, new_parent, std::numeric_limits<size_t>::max());
+		}
+
+		void set_parent(const K& key, const K& new_parent, size_t position)
+		{
+			_operations.emplace_back(transaction_set_parent<K>{ key, new_parent, position });
+		}
+
+		void assign(const K& key, const T& value)
+		{
+			_operations.emplace_back(transaction_assign<K, T>{ key, value });
+		}
+
+		void assign(const K& key, T&& value)
+		{
+			_operations.emplace_back(transaction_assign<K, T>{ key, std::move(value) });
+		}
+
+		void reserve(size_t count)
+		{
+			_operations.reserve(count);
+		}
+
+		size_t size() const
+		{
+			return _operations.size();
+		}
+
+		bool empty() const
+		{
+			return _operations.empty();
+		}
+
+		void commit()
+		{
+			std::vector<operation> operations{ std::move(_operations) };
+			_operations.clear();
+			_tree->apply(operations);
+		}
+
+		void rollback()
+		{
+			_operations.clear();
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,494 @@
+#ifndef BYTE_INPLACEHASHTREE_H
+#define BYTE_INPLACEHASHTREE_H
+
+#include "hash_tree.h"
+#include "inplace_sparse_vector.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <bit>
+
+namespace Byte
+{
+
+	template<size_t Capacity>
+	using inplace_hash_tree_index = std::conditional_t<(Capacity <= std::numeric_limits<uint8_t>::max()), uint8_t,
+		std::conditional_t<(Capacity <= std::numeric_limits<uint16_t>::max()), uint16_t,
+		std::conditional_t<(Capacity <= std::numeric_limits<uint32_t>::max()), uint32_t, size_t>>>;
+
+	template<typename Index>
+	struct inplace_child_links
+	{
+		Index first_child{ _empty_index<Index> };
+		Index last_child{ _empty_index<Index> };
+		Index next_sibling{ _empty_index<Index> };
+	};
+
+	template<typename Tree, typename T>
+	class inplace_hash_tree_iterator
+	{
+	private:
+		using tree_ptr = std::conditional_t<std::is_const<T>::value, const Tree*, Tree*>;
+		using index_type = typename Tree::index_type;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T*;
+		using reference = value_type&;
+
+	private:
+		tree_ptr _tree;
+		index_type _current;
+		index_type _level;
+		size_t _index;
+
+	public:
+		inplace_hash_tree_iterator(tree_ptr tree, index_type head_index, size_t index)
+			:_tree{ tree }, _current{ head_index }, _level{ head_index }, _index{ index }
+		{
+		}
+
+		T& operator*() const
+		{
+			return _tree->_nodes[_current].pair.second;
+		}
+
+		T* operator->() const
+		{
+			return &_tree->_nodes[_current].pair.second;
+		}
+
+		inplace_hash_tree_iterator& operator++()
+		{
+			_current = _tree->next_in_level(_current);
+			if (_current == Tree::EMPTY)
+			{
+				_current = _tree->next_level(_level);
+				_level = _current;
+			}
+			++_index;
+
+			return *this;
+		}
+
+		inplace_hash_tree_iterator operator++(int)
+		{
+			inplace_hash_tree_iterator out{ *this };
+			++(*this);
+			return out;
+		}
+
+		bool operator==(const inplace_hash_tree_iterator& left) const
+		{
+			return _index == left._index;
+		}
+
+		bool operator!=(const inplace_hash_tree_iterator& left) const
+		{
+			return _index != left._index;
+		}
+	};
+
+	template<
+		typename K,
+		typename T,
+		size_t Capacity,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = inplace_hash_tree_index<Capacity>>
+	class inplace_hash_tree
+	{
+	private:
+		static_assert(std::is_unsigned<Index>::value, "inplace_hash_tree index type must be unsigned");
+		static_assert(Capacity <= _empty_index<Index>, "inplace_hash_tree capacity must fit the index type");
+
+		inline static constexpr Index EMPTY{ _empty_index<Index> };
+		inline static constexpr size_t TABLE_SIZE{ std::bit_ceil(Capacity) };
+
+		using chain = hash_tree_chain<K, Hasher, Keyeq, Index>;
+		using node_type = typename chain::template node_type<T, inplace_child_links<Index>>;
+		using node_container = inplace_sparse_vector<node_type, Capacity>;
+
+		template<typename, typename>
+		friend class inplace_hash_tree_iterator;
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+
+		using value_type = std::pair<const K, T>;
+		using size_type = size_t;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+
+		using index_type = Index;
+
+		using iterator = inplace_hash_tree_iterator<inplace_hash_tree, T>;
+		using const_iterator = inplace_hash_tree_iterator<inplace_hash_tree, const T>;
+
+	private:
+		node_container _nodes;
+		std::array<Index, TABLE_SIZE> _table;
+		Index _head_index{ EMPTY };
+		Hasher _hasher;
+		Keyeq _keyeq;
+
+	public:
+		inplace_hash_tree()
+		{
+			_table.fill(EMPTY);
+		}
+
+		inplace_hash_tree(const inplace_hash_tree& left) = default;
+
+		inplace_hash_tree(inplace_hash_tree&& right)
+			:_nodes{ std::move(right._nodes) },
+			_table{ right._table },
+			_head_index{ right._head_index },
+			_hasher{ std::move(right._hasher) },
+			_keyeq{ std::move(right._keyeq) }
+		{
+			right.clear();
+		}
+
+		inplace_hash_tree& operator=(const inplace_hash_tree& left) = default;
+
+		inplace_hash_tree& operator=(inplace_hash_tree&& right)
+		{
+			if (this != &right)
+			{
+				_nodes = std::move(right._nodes);
+				_table = right._table;
+				_head_index = right._head_index;
+				_hasher = std::move(right._hasher);
+				_keyeq = std::move(right._keyeq);
+				right.clear();
+			}
+
+			return *this;
+		}
+
+		~inplace_hash_tree() = default;
+
+		void insert(const K& key, const T& value)
+		{
+			insert(K{ key }, T{ value });
+		}
+
+		void insert(const K& key, T&& value)
+		{
+			insert(K{ key }, std::move(value));
+		}
+
+		void insert(K&& key, T&& value)
+		{
+			Index _index{ _insert(std::move(key), std::move(value)) };
+			if (_head_index == EMPTY)
+			{
+				_head_index = _index;
+			}
+			else
+			{
+				link_child(_head_index, _index);
+			}
+		}
+
+		void insert(const K& key, const T& value, const K& parent)
+		{
+			insert(K{ key }, T{ value }, parent);
+		}
+
+		void insert(const K& key, T&& value, const K& parent)
+		{
+			insert(K{ key }, std::move(value), parent);
+		}
+
+		void insert(K&& key, T&& value, const K& parent)
+		{
+			Index parent_index{ index(parent) };
+			Index _index{ _insert(std::move(key), std::move(value)) };
+			link_child(parent_index, _index);
+		}
+
+		void erase(const K& key)
+		{
+			_erase(index(key));
+		}
+
+		void set_parent(const K& key, const K& new_parent)
+		{
+			Index _index{ index(key) };
+			Index parent_index{ index(new_parent) };
+
+			unlink_child(_index);
+			link_child(parent_index, _index);
+		}
+
+		void set_parent(const K& key, const K& new_parent, size_t position)
+		{
+			Index _index{ index(key) };
+			Index parent_index{ index(new_parent) };
+
+			unlink_child(_index);
+			link_child(parent_index, _index, position);
+		}
+
+		T& at(const K& key)
+		{
+			return _nodes[index(key)].pair.second;
+		}
+
+		const T& at(const K& key) const
+		{
+			return _nodes[index(key)].pair.second;
+		}
+
+		T& operator[](const K& key)
+		{
+			Index _index{ index(key) };
+
+			if (_index == EMPTY)
+			{
+				insert(key, T{});
+				_index = index(key);
+			}
+
+			return _nodes[_index].pair.second;
+		}
+
+		const T& operator[](const K& key) const
+		{
+			return at(key);
+		}
+
+		bool contains(const K& key) const
+		{
+			return index(key) != EMPTY;
+		}
+
+		double load_factor() const
+		{
+			return size() / static_cast<double>(table_size());
+		}
+
+		iterator begin()
+		{
+			return iterator{ this, _head_index, 0 };
+		}
+
+		iterator end()
+		{
+			return iterator{ this, EMPTY, size() };
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator{ this, _head_index, 0 };
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator{ this, EMPTY, size() };
+		}
+
+		size_t size() const
+		{
+			return _nodes.size();
+		}
+
+		bool empty() const
+		{
+			return _nodes.empty();
+		}
+
+		bool full() const
+		{
+			return size() == Capacity;
+		}
+
+		static constexpr size_t capacity()
+		{
+			return Capacity;
+		}
+
+		static constexpr size_t table_size()
+		{
+			return TABLE_SIZE;
+		}
+
+		void clear()
+		{
+			_nodes.clear();
+			_table.fill(EMPTY);
+			_head_index = EMPTY;
+		}
+
+	private:
+		Index index(const K& key) const
+		{
+			size_t hash_value{ _hasher(key) };
+			return chain::find(_nodes, _table[hash_value & (TABLE_SIZE - 1)], hash_value, key, _keyeq);
+		}
+
+		Index _insert(K&& key, T&& value)
+		{
+			size_t hash_value{ _hasher(key) };
+			Index _index{ chain::emplace(_nodes, hash_value, std::move(key), std::move(value)) };
+			chain::link(_nodes, _table, hash_value & (TABLE_SIZE - 1), _index);
+
+			return _index;
+		}
+
+		void _erase(Index _index)
+		{
+			if (_index == _head_index)
+			{
+				clear();
+				return;
+			}
+
+			unlink_child(_index);
+
+			Index current{ _index };
+			while (true)
+			{
+				while (_nodes[current].childs.first_child != EMPTY)
+				{
+					current = _nodes[current].childs.first_child;
+				}
+
+				Index parent_index{ _nodes[current].parent_index };
+				if (current != _index)
+				{
+					inplace_child_links<Index>& links{ _nodes[parent_index].childs };
+					links.first_child = _nodes[current].childs.next_sibling;
+					if (links.first_child == EMPTY)
+					{
+						links.last_child = EMPTY;
+					}
+				}
+
+				chain::unlink(_nodes, _table, chain::hash_of(_nodes[current], _hasher) & (TABLE_SIZE - 1), current);
+				_nodes.erase(current);
+
+				if (current == _index)
+				{
+					break;
+				}
+				current = parent_index;
+			}
+		}
+
+		void link_child(Index parent_index, Index _index)
+		{
+			inplace_child_links<Index>& links{ _nodes[parent_index].childs };
+
+			_nodes[_index].parent_index = parent_index;
+			(links.last_child == EMPTY ? links.first_child : _nodes[links.last_child].childs.next_sibling) = _index;
+			links.last_child = _index;
+		}
+
+		void link_child(Index parent_index, Index _index, size_t position)
+		{
+			inplace_child_links<Index>& links{ _nodes[parent_index].childs };
+
+			Index prev{ EMPTY };
+			Index next{ links.first_child };
+			for (; next != EMPTY && position != 0; --position)
+			{
+				prev = next;
+				next = _nodes[next].childs.next_sibling;
+			}
+
+			_nodes[_index].parent_index = parent_index;
+			_nodes[_index].childs.next_sibling = next;
+
+			(prev == EMPTY ? links.first_child : _nodes[prev].childs.next_sibling) = _index;
+			if (next == EMPTY)
+			{
+				links.last_child = _index;
+			}
+		}
+
+		void unlink_child(Index _index)
+		{
+			Index parent_index{ _nodes[_index].parent_index };
+			if (parent_index == EMPTY)
+			{
+				return;
+			}
+
+			inplace_child_links<Index>& links{ _nodes[parent_index].childs };
+
+			Index prev{ EMPTY };
+			for (Index i{ links.first_child }; i != _index; i = _nodes[i].childs.next_sibling)
+			{
+				prev = i;
+			}
+
+			Index next{ _nodes[_index].childs.next_sibling };
+			(prev == EMPTY ? links.first_child : _nodes[prev].childs.next_sibling) = next;
+			if (next == EMPTY)
+			{
+				links.last_child = prev;
+			}
+
+			_nodes[_index].parent_index = EMPTY;
+			_nodes[_index].childs.next_sibling = EMPTY;
+		}
+
+		Index next_in_level(Index _index) const
+		{
+			size_t depth{ 0 };
+			while (true)
+			{
+				while (_nodes[_index].childs.next_sibling == EMPTY)
+				{
+					_index = _nodes[_index].parent_index;
+					if (_index == EMPTY)
+					{
+						return EMPTY;
+					}
+					++depth;
+				}
+
+				_index = _nodes[_index].childs.next_sibling;
+				while (depth != 0 && _nodes[_index].childs.first_child != EMPTY)
+				{
+					_index = _nodes[_index].childs.first_child;
+					--depth;
+				}
+
+				if (depth == 0)
+				{
+					return _index;
+				}
+			}
+		}
+
+		Index next_level(Index _index) const
+		{
+			for (; _index != EMPTY; _index = next_in_level(_index))
+			{
+				if (_nodes[_index].childs.first_child != EMPTY)
+				{
+					return _nodes[_index].childs.first_child;
+				}
+			}
+
+			return EMPTY;
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef BYTE_INPLACESPARSEVECTOR_H
+#define BYTE_INPLACESPARSEVECTOR_H
+
+#include "sparse_vector.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace Byte
+{
+
+	template<typename T, size_t Capacity>
+	class inplace_sparse_vector
+	{
+	private:
+		inline static constexpr size_t BITSET_COUNT{ (Capacity + _BITSET_SIZE - 1) / _BITSET_SIZE };
+
+		struct alignas(T) slot
+		{
+			unsigned char bytes[sizeof(T)];
+		};
+
+	public:
+		using value_type = T;
+		using pointer = T*;
+		using const_pointer = const T*;
+		using reference = T&;
+		using const_reference = const T&;
+		using size_type = size_t;
+		using difference_type = std::ptrdiff_t;
+
+	private:
+		std::array<slot, Capacity> _data;
+		std::array<uint64_t, BITSET_COUNT> _bitsets{};
+		size_t _size{ 0 };
+
+	public:
+		inplace_sparse_vector() = default;
+
+		inplace_sparse_vector(const inplace_sparse_vector& left)
+		{
+			copy(left);
+		}
+
+		inplace_sparse_vector(inplace_sparse_vector&& right)
+		{
+			move(std::move(right));
+		}
+
+		inplace_sparse_vector& operator=(const inplace_sparse_vector& left)
+		{
+			if (this != &left)
+			{
+				clear();
+				copy(left);
+			}
+
+			return *this;
+		}
+
+		inplace_sparse_vector& operator=(inplace_sparse_vector&& right)
+		{
+			if (this != &right)
+			{
+				clear();
+				move(std::move(right));
+			}
+
+			return *this;
+		}
+
+		~inplace_sparse_vector()
+		{
+			clear();
+		}
+
+		template<class... Args>
+		[[maybe_unused]] size_t emplace(Args&&... args)
+		{
+			size_t index{ free_index() };
+			std::construct_at(address(index), std::forward<Args>(args)...);
+			_bitsets[index / _BITSET_SIZE] |= 1ULL << (index % _BITSET_SIZE);
+			++_size;
+
+			return index;
+		}
+
+		void erase(size_t index)
+		{
+			_bitsets[index / _BITSET_SIZE] &= ~(1ULL << (index % _BITSET_SIZE));
+
+			if (!std::is_trivially_destructible<T>::value)
+			{
+				std::destroy_at(address(index));
+			}
+
+			--_size;
+		}
+
+		reference at(size_t index)
+		{
+			return *address(index);
+		}
+
+		const_reference at(size_t index) const
+		{
+			return *address(index);
+		}
+
+		reference operator[](size_t index)
+		{
+			return at(index);
+		}
+
+		const_reference operator[](size_t index) const
+		{
+			return at(index);
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+
+		bool empty() const
+		{
+			return _size == 0;
+		}
+
+		static constexpr size_t capacity()
+		{
+			return Capacity;
+		}
+
+		bool test(size_t index) const
+		{
+			return (_bitsets[index / _BITSET_SIZE] >> (index % _BITSET_SIZE)) & 1ULL;
+		}
+
+		void clear()
+		{
+			if (!std::is_trivially_destructible<T>::value)
+			{
+				for_each_index([this](size_t index)
+					{
+						std::destroy_at(address(index));
+					});
+			}
+
+			_bitsets.fill(0);
+			_size = 0;
+		}
+
+	private:
+		T* address(size_t index)
+		{
+			return std::launder(reinterpret_cast<T*>(&_data[index]));
+		}
+
+		const T* address(size_t index) const
+		{
+			return std::launder(reinterpret_cast<const T*>(&_data[index]));
+		}
+
+		size_t free_index() const
+		{
+			for (size_t bitset_index{ 0 }; bitset_index < BITSET_COUNT; ++bitset_index)
+			{
+				size_t index{ bitset_index * _BITSET_SIZE + std::countr_one(_bitsets[bitset_index]) };
+				if (index < (bitset_index + 1) * _BITSET_SIZE && index < Capacity)
+				{
+					return index;
+				}
+			}
+
+			throw std::length_error{ "inplace_sparse_vector: capacity exceeded" };
+		}
+
+		template<typename Function>
+		void for_each_index(Function&& function) const
+		{
+			for (size_t bitset_index{ 0 }; bitset_index < BITSET_COUNT; ++bitset_index)
+			{
+				for (uint64_t bitset{ _bitsets[bitset_index] }; bitset != 0; bitset &= bitset - 1)
+				{
+					function(bitset_index * _BITSET_SIZE + std::countr_zero(bitset));
+				}
+			}
+		}
+
+		void copy(const inplace_sparse_vector& left)
+		{
+			left.for_each_index([this, &left](size_t index)
+				{
+					std::construct_at(address(index), left[index]);
+				});
+
+			_bitsets = left._bitsets;
+			_size = left._size;
+		}
+
+		void move(inplace_sparse_vector&& right)
+		{
+			right.for_each_index([this, &right](size_t index)
+				{
+					std::construct_at(address(index), std::move(right[index]));
+				});
+
+			_bitsets = right._bitsets;
+			_size = right._size;
+			right.clear();
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,670 @@
+#ifndef BYTE_MVCCHASHTREE_H
+#define BYTE_MVCCHASHTREE_H
+
+#include "hash_tree.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	using mvcc_version = uint64_t;
+
+	inline constexpr mvcc_version _LATEST_VERSION{ std::numeric_limits<mvcc_version>::max() };
+
+	struct mvcc_child_entry
+	{
+		size_t index;
+		mvcc_version added;
+		mvcc_version removed{ _LATEST_VERSION };
+
+		bool visible(mvcc_version version) const
+		{
+			return added <= version && version < removed;
+		}
+	};
+
+	template<typename T>
+	struct mvcc_value_version
+	{
+		T value;
+		mvcc_version created;
+		std::unique_ptr<mvcc_value_version> older;
+
+		~mvcc_value_version()
+		{
+			while (older)
+			{
+				older = std::move(older->older);
+			}
+		}
+	};
+
+	template<typename K, typename T>
+	struct mvcc_hash_tree_node
+	{
+		using version_type = mvcc_value_version<T>;
+		using child_container = std::vector<mvcc_child_entry>;
+
+		K key;
+		std::unique_ptr<version_type> value;
+		size_t hash_value;
+		mvcc_version created;
+		mvcc_version erased{ _LATEST_VERSION };
+		child_container childs;
+		size_t parent_index{ _EMPTY_INDEX };
+		size_t next_index{ _EMPTY_INDEX };
+
+		bool visible(mvcc_version version) const
+		{
+			return created <= version && version < erased;
+		}
+
+		const T& value_at(mvcc_version version) const
+		{
+			const version_type* it{ value.get() };
+			while (it->created > version)
+			{
+				it = it->older.get();
+			}
+
+			return it->value;
+		}
+	};
+
+	template<typename Tree, typename T>
+	class mvcc_hash_tree_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+	private:
+		const Tree* _tree;
+		mvcc_version _version;
+		std::vector<size_t> _visit;
+		size_t _index{ 0 };
+		const T* _value{ nullptr };
+
+	public:
+		mvcc_hash_tree_iterator(const Tree* tree, mvcc_version version, bool at_end)
+			:_tree{ tree }, _version{ version }
+		{
+			if (at_end)
+			{
+				return;
+			}
+
+			std::shared_lock lock{ _tree->_mutex };
+			size_t head_index{ _tree->head_index(_version) };
+			if (head_index != _EMPTY_INDEX)
+			{
+				_visit.push_back(head_index);
+				_value = &_tree->_nodes[head_index].value_at(_version);
+			}
+		}
+
+		reference operator*() const
+		{
+			return *_value;
+		}
+
+		pointer operator->() const
+		{
+			return _value;
+		}
+
+		mvcc_hash_tree_iterator& operator++()
+		{
+			std::shared_lock lock{ _tree->_mutex };
+			for (const mvcc_child_entry& entry : _tree->_nodes[_visit[_index]].childs)
+			{
+				if (entry.visible(_version))
+				{
+					_visit.push_back(entry.index);
+				}
+			}
+
+			if (++_index < _visit.size())
+			{
+				_value = &_tree->_nodes[_visit[_index]].value_at(_version);
+			}
+
+			return *this;
+		}
+
+		mvcc_hash_tree_iterator operator++(int)
+		{
+			mvcc_hash_tree_iterator out{ *this };
+			++(*this);
+			return out;
+		}
+
+		bool operator==(const mvcc_hash_tree_iterator& left) const
+		{
+			return done() == left.done() && (done() || _index == left._index);
+		}
+
+		bool operator!=(const mvcc_hash_tree_iterator& left) const
+		{
+			return !(*this == left);
+		}
+
+	private:
+		bool done() const
+		{
+			return _index >= _visit.size();
+		}
+	};
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>>
+	class mvcc_hash_tree
+	{
+	private:
+		inline static constexpr double MAX_LOAD{ 0.9 };
+
+		using node_type = mvcc_hash_tree_node<K, T>;
+		using node_container = sparse_vector<node_type>;
+		using node_map = std::vector<size_t>;
+		using view_map = std::map<mvcc_version, size_t>;
+
+		enum class garbage_kind
+		{
+			subtree,
+			entry,
+			value
+		};
+
+		struct garbage
+		{
+			mvcc_version version;
+			size_t node_index;
+			size_t parent_index;
+			garbage_kind kind;
+		};
+
+		template<typename, typename>
+		friend class mvcc_hash_tree_iterator;
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+		using value_type = std::pair<const K, T>;
+
+		using iterator = mvcc_hash_tree_iterator<mvcc_hash_tree, T>;
+		using const_iterator = iterator;
+
+		class read_view
+		{
+		private:
+			mvcc_hash_tree* _tree;
+			mvcc_version _version;
+
+			friend class mvcc_hash_tree;
+
+			read_view(mvcc_hash_tree* tree, mvcc_version version)
+				:_tree{ tree }, _version{ version }
+			{
+			}
+
+		public:
+			read_view(const read_view& left) = delete;
+
+			read_view(read_view&& right) noexcept
+				:_tree{ right._tree }, _version{ right._version }
+			{
+				right._tree = nullptr;
+			}
+
+			read_view& operator=(const read_view& left) = delete;
+
+			read_view& operator=(read_view&& right) noexcept
+			{
+				if (this != &right)
+				{
+					reset();
+					_tree = right._tree;
+					_version = right._version;
+					right._tree = nullptr;
+				}
+
+				return *this;
+			}
+
+			~read_view()
+			{
+				reset();
+			}
+
+			const T& at(const K& key) const
+			{
+				std::shared_lock lock{ _tree->_mutex };
+				return _tree->_nodes[_tree->existing(key, _version)].value_at(_version);
+			}
+
+			bool contains(const K& key) const
+			{
+				std::shared_lock lock{ _tree->_mutex };
+				return _tree->index(key, _version) != _EMPTY_INDEX;
+			}
+
+			const_iterator begin() const
+			{
+				return const_iterator{ _tree, _version, false };
+			}
+
+			const_iterator end() const
+			{
+				return const_iterator{ _tree, _version, true };
+			}
+
+			mvcc_version version() const
+			{
+				return _version;
+			}
+
+			void reset()
+			{
+				if (_tree)
+				{
+					_tree->release(_version);
+					_tree = nullptr;
+				}
+			}
+		};
+
+	private:
+		mutable std::shared_mutex _mutex;
+		node_container _nodes;
+		node_map _table{ _EMPTY_INDEX, _EMPTY_INDEX };
+		std::vector<mvcc_child_entry> _heads;
+		std::deque<garbage> _garbage;
+		view_map _views;
+		mvcc_version _version{ 0 };
+		mvcc_version _oldest_version{ 0 };
+		size_t _size{ 0 };
+		Hasher _hasher;
+		Keyeq _keyeq;
+
+	public:
+		mvcc_hash_tree() = default;
+
+		mvcc_hash_tree(const mvcc_hash_tree& left) = delete;
+
+		mvcc_hash_tree& operator=(const mvcc_hash_tree& left) = delete;
+
+		void insert(const K& key, const T& value)
+		{
+			insert(K{ key }, T{ value });
+		}
+
+		void insert(K&& key, T&& value)
+		{
+			std::unique_lock lock{ _mutex };
+			size_t head{ head_index(_version) };
+			if (head != _EMPTY_INDEX)
+			{
+				_insert(std::move(key), std::move(value), head);
+				return;
+			}
+
+			++_version;
+			size_t _index{ _emplace(std::move(key), std::move(value)) };
+			_heads.push_back(mvcc_child_entry{ _index, _version });
+		}
+
+		void insert(const K& key, const T& value, const K& parent)
+		{
+			insert(K{ key }, T{ value }, parent);
+		}
+
+		void insert(K&& key, T&& value, const K& parent)
+		{
+			std::unique_lock lock{ _mutex };
+			_insert(std::move(key), std::move(value), index(parent, _version));
+		}
+
+		void erase(const K& key)
+		{
+			std::unique_lock lock{ _mutex };
+			size_t _index{ index(key, _version) };
+			++_version;
+
+			size_t parent_index{ _nodes[_index].parent_index };
+			remove_entry(parent_index == _EMPTY_INDEX ? _heads : _nodes[parent_index].childs, _index);
+
+			std::vector<size_t> visit{ _index };
+			for (size_t i{ 0 }; i < visit.size(); ++i)
+			{
+				node_type& node{ _nodes[visit[i]] };
+				for (const mvcc_child_entry& entry : node.childs)
+				{
+					if (entry.visible(_version - 1))
+					{
+						visit.push_back(entry.index);
+					}
+				}
+
+				node.erased = _version;
+				--_size;
+			}
+
+			_garbage.push_back(garbage{ _version, _index, parent_index, garbage_kind::subtree });
+			_collect();
+		}
+
+		void set_parent(const K& key, const K& new_parent)
+		{
+			set_parent(key, new_parent, std::numeric_limits<size_t>::max());
+		}
+
+		void set_parent(const K& key, const K& new_parent, size_t position)
+		{
+			std::unique_lock lock{ _mutex };
+			size_t _index{ index(key, _version) };
+			size_t parent_index{ index(new_parent, _version) };
+			++_version;
+
+			size_t old_parent{ _nodes[_index].parent_index };
+			remove_entry(old_parent == _EMPTY_INDEX ? _heads : _nodes[old_parent].childs, _index);
+			_garbage.push_back(garbage{ _version, _EMPTY_INDEX, old_parent, garbage_kind::entry });
+
+			add_entry(_nodes[parent_index].childs, _index, position);
+			_nodes[_index].parent_index = parent_index;
+
+			_collect();
+		}
+
+		void assign(const K& key, const T& value)
+		{
+			assign(key, T{ value });
+		}
+
+		void assign(const K& key, T&& value)
+		{
+			std::unique_lock lock{ _mutex };
+			size_t _index{ index(key, _version) };
+			++_version;
+
+			node_type& node{ _nodes[_index] };
+			node.value.reset(new typename node_type::version_type{ std::move(value), _version, std::move(node.value) });
+			_garbage.push_back(garbage{ _version, _index, _EMPTY_INDEX, garbage_kind::value });
+
+			_collect();
+		}
+
+		T at(const K& key) const
+		{
+			std::shared_lock lock{ _mutex };
+			return _nodes[existing(key, _version)].value_at(_version);
+		}
+
+		bool contains(const K& key) const
+		{
+			std::shared_lock lock{ _mutex };
+			return index(key, _version) != _EMPTY_INDEX;
+		}
+
+		read_view view()
+		{
+			std::unique_lock lock{ _mutex };
+			++_views[_version];
+			return read_view{ this, _version };
+		}
+
+		read_view view(mvcc_version version)
+		{
+			std::unique_lock lock{ _mutex };
+			if (version < _oldest_version || version > _version)
+			{
+				throw std::out_of_range{ "mvcc_hash_tree: version is no longer retained" };
+			}
+
+			++_views[version];
+			return read_view{ this, version };
+		}
+
+		void collect()
+		{
+			std::unique_lock lock{ _mutex };
+			_collect();
+		}
+
+		mvcc_version version() const
+		{
+			std::shared_lock lock{ _mutex };
+			return _version;
+		}
+
+		mvcc_version oldest_version() const
+		{
+			std::shared_lock lock{ _mutex };
+			return _oldest_version;
+		}
+
+		size_t size() const
+		{
+			std::shared_lock lock{ _mutex };
+			return _size;
+		}
+
+		size_t retained_size() const
+		{
+			std::shared_lock lock{ _mutex };
+			return _nodes.size();
+		}
+
+		size_t table_size() const
+		{
+			return _table.size();
+		}
+
+	private:
+		size_t index(const K& key, mvcc_version version) const
+		{
+			size_t hash_value{ _hasher(key) };
+			size_t _index{ _table[hash_value % table_size()] };
+
+			while (_index != _EMPTY_INDEX)
+			{
+				const node_type& node{ _nodes[_index] };
+				if (node.hash_value == hash_value && node.visible(version) && _keyeq(node.key, key))
+				{
+					return _index;
+				}
+				_index = node.next_index;
+			}
+
+			return _EMPTY_INDEX;
+		}
+
+		size_t existing(const K& key, mvcc_version version) const
+		{
+			size_t _index{ index(key, version) };
+			if (_index == _EMPTY_INDEX)
+			{
+				throw std::out_of_range{ "mvcc_hash_tree: key not found" };
+			}
+
+			return _index;
+		}
+
+		size_t head_index(mvcc_version version) const
+		{
+			for (auto it{ _heads.rbegin() }; it != _heads.rend(); ++it)
+			{
+				if (it->visible(version))
+				{
+					return it->index;
+				}
+			}
+
+			return _EMPTY_INDEX;
+		}
+
+		void _insert(K&& key, T&& value, size_t parent_index)
+		{
+			++_version;
+			size_t _index{ _emplace(std::move(key), std::move(value)) };
+
+			_nodes[parent_index].childs.push_back(mvcc_child_entry{ _index, _version });
+			_nodes[_index].parent_index = parent_index;
+		}
+
+		size_t _emplace(K&& key, T&& value)
+		{
+			if (_nodes.size() / static_cast<double>(table_size()) > MAX_LOAD)
+			{
+				rehash(table_size() * 2);
+			}
+
+			size_t hash_value{ _hasher(key) };
+			auto version{ std::make_unique<typename node_type::version_type>(std::move(value), _version) };
+			size_t _index{ _nodes.emplace(std::move(key), std::move(version), hash_value, _version) };
+
+			size_t& bucket{ _table[hash_value % table_size()] };
+			_nodes[_index].next_index = bucket;
+			bucket = _index;
+
+			++_size;
+			return _index;
+		}
+
+		void add_entry(std::vector<mvcc_child_entry>& entries, size_t _index, size_t position)
+		{
+			auto it{ entries.begin() };
+			for (; it != entries.end(); ++it)
+			{
+				if (it->visible(_version) && position-- == 0)
+				{
+					break;
+				}
+			}
+
+			entries.insert(it, mvcc_child_entry{ _index, _version });
+		}
+
+		void remove_entry(std::vector<mvcc_child_entry>& entries, size_t _index)
+		{
+			for (mvcc_child_entry& entry : entries)
+			{
+				if (entry.index == _index && entry.removed == _LATEST_VERSION)
+				{
+					entry.removed = _version;
+					return;
+				}
+			}
+		}
+
+		void release(mvcc_version version)
+		{
+			std::unique_lock lock{ _mutex };
+			auto it{ _views.find(version) };
+			if (--it->second == 0)
+			{
+				_views.erase(it);
+			}
+		}
+
+		void _collect()
+		{
+			mvcc_version horizon{ _views.empty() ? _LATEST_VERSION : _views.begin()->first };
+
+			while (!_garbage.empty() && _garbage.front().version <= horizon)
+			{
+				garbage item{ _garbage.front() };
+				_garbage.pop_front();
+
+				if (item.kind == garbage_kind::value)
+				{
+					typename node_type::version_type* it{ _nodes[item.node_index].value.get() };
+					while (it->created != item.version)
+					{
+						it = it->older.get();
+					}
+					it->older.reset();
+				}
+				else
+				{
+					std::vector<mvcc_child_entry>& entries{ item.parent_index == _EMPTY_INDEX ? _heads : _nodes[item.parent_index].childs };
+					std::erase_if(entries, [&item](const mvcc_child_entry& entry) { return entry.removed == item.version; });
+
+					if (item.kind == garbage_kind::subtree)
+					{
+						free_subtree(item.node_index);
+					}
+				}
+
+				_oldest_version = item.version;
+			}
+		}
+
+		void free_subtree(size_t _index)
+		{
+			std::vector<size_t> visit{ _index };
+			while (!visit.empty())
+			{
+				size_t current{ visit.back() };
+				visit.pop_back();
+
+				for (const mvcc_child_entry& entry : _nodes[current].childs)
+				{
+					if (entry.removed == _LATEST_VERSION)
+					{
+						visit.push_back(entry.index);
+					}
+				}
+
+				remove_map(current);
+				_nodes.erase(current);
+			}
+		}
+
+		void remove_map(size_t node_index)
+		{
+			size_t* it{ &_table[_nodes[node_index].hash_value % table_size()] };
+			while (*it != node_index)
+			{
+				it = &_nodes[*it].next_index;
+			}
+			*it = _nodes[node_index].next_index;
+		}
+
+		void rehash(size_t new_size)
+		{
+			_table.assign(new_size, _EMPTY_INDEX);
+			_table.shrink_to_fit();
+
+			for (auto it{ _nodes.begin() }; it != _nodes.end(); ++it)
+			{
+				size_t& bucket{ _table[it->hash_value % table_size()] };
+				it->next_index = bucket;
+				bucket = it.index();
+			}
+		}
+	};
+
+}
+
+#endif
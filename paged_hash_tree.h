@@ -0,0 +1,530 @@
+#ifndef BYTE_PAGEDHASHTREE_H
+#define BYTE_PAGEDHASHTREE_H
+
+#include "frozen_hash_tree.h"
+#include "hash_tree_codec.h"
+
+#if __has_include(<sys/mman.h>)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	struct paged_file_header
+	{
+		uint64_t magic;
+		uint64_t size;
+		uint64_t page_count;
+		uint64_t slot_count;
+		uint64_t child_count;
+	};
+
+	inline constexpr uint64_t _PAGED_FILE_MAGIC{ 0x4259544550414746ULL };
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename KeyCodec = codec<K>,
+		typename ValueCodec = codec<T>>
+	class paged_hash_tree
+	{
+	private:
+		inline static constexpr uint64_t EMPTY{ std::numeric_limits<uint64_t>::max() };
+
+		struct page
+		{
+			std::vector<K> keys;
+			std::vector<T> values;
+			size_t bytes{ 0 };
+			bool loaded{ false };
+			std::list<size_t>::iterator lru;
+		};
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+
+	private:
+		void* _file{ nullptr };
+		size_t _file_size{ 0 };
+
+		const paged_file_header* _header{ nullptr };
+		const uint64_t* _page_starts{ nullptr };
+		const uint64_t* _page_offsets{ nullptr };
+		const uint64_t* _child_offsets{ nullptr };
+		const uint64_t* _childs{ nullptr };
+		const uint64_t* _slots{ nullptr };
+		const char* _payload{ nullptr };
+
+		std::vector<page> _pages;
+		std::list<size_t> _lru;
+		size_t _budget;
+		size_t _resident_bytes{ 0 };
+		Hasher _hasher;
+		Keyeq _keyeq;
+		KeyCodec _key_codec;
+		ValueCodec _value_codec;
+
+	public:
+		explicit paged_hash_tree(
+			const std::string& path,
+			size_t budget = 1ULL << 28,
+			const Hasher& hasher = {},
+			const Keyeq& keyeq = {},
+			const KeyCodec& key_codec = {},
+			const ValueCodec& value_codec = {})
+			:_budget{ budget },
+			_hasher{ hasher },
+			_keyeq{ keyeq },
+			_key_codec{ key_codec },
+			_value_codec{ value_codec }
+		{
+			int fd{ ::open(path.c_str(), O_RDONLY) };
+			struct stat status;
+			if (fd < 0 || ::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(paged_file_header))
+			{
+				if (fd >= 0)
+				{
+					::close(fd);
+				}
+				throw std::runtime_error{ "paged_hash_tree: cannot open file" };
+			}
+
+			_file_size = status.st_size;
+			_file = ::mmap(nullptr, _file_size, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (_file == MAP_FAILED)
+			{
+				_file = nullptr;
+				throw std::runtime_error{ "paged_hash_tree: cannot map file" };
+			}
+
+			try
+			{
+				bind();
+				load(0);
+			}
+			catch (...)
+			{
+				::munmap(_file, _file_size);
+				throw;
+			}
+		}
+
+		paged_hash_tree(const paged_hash_tree& left) = delete;
+
+		paged_hash_tree& operator=(const paged_hash_tree& left) = delete;
+
+		~paged_hash_tree()
+		{
+			if (_file)
+			{
+				::munmap(_file, _file_size);
+			}
+		}
+
+		template<typename Index>
+		static void write(
+			const std::string& path,
+			const frozen_hash_tree<K, T, Hasher, Keyeq, Index>& tree,
+			size_t resident_depth = 2,
+			size_t page_bytes = 1ULL << 16,
+			const KeyCodec& key_codec = {},
+			const ValueCodec& value_codec = {},
+			const Hasher& hasher = {})
+		{
+			constexpr Index FROZEN_EMPTY{ std::numeric_limits<Index>::max() };
+			size_t count{ tree.size() };
+
+			std::vector<size_t> preorder;
+			std::vector<size_t> depths(count);
+			std::vector<size_t> visit;
+			preorder.reserve(count);
+			for (size_t position{ count }; position-- > 0;)
+			{
+				if (tree._parents[position] == FROZEN_EMPTY)
+				{
+					visit.push_back(position);
+				}
+			}
+
+			while (!visit.empty() && preorder.size() < count)
+			{
+				size_t position{ visit.back() };
+				visit.pop_back();
+				preorder.push_back(position);
+
+				for (Index child{ tree._child_offsets[position + 1] }; child-- > tree._child_offsets[position];)
+				{
+					depths[tree._childs[child]] = depths[position] + 1;
+					visit.push_back(tree._childs[child]);
+				}
+			}
+
+			if (preorder.size() != count || !visit.empty())
+			{
+				throw std::invalid_argument{ "paged_hash_tree: tree has nodes that are not reachable from a root" };
+			}
+
+			std::vector<size_t> order;
+			order.reserve(count);
+			for (size_t position : preorder)
+			{
+				if (depths[position] < resident_depth)
+				{
+					order.push_back(position);
+				}
+			}
+
+			std::vector<uint64_t> page_starts{ 0 };
+			std::vector<std::string> payloads;
+			std::ostringstream current;
+			for (size_t position : order)
+			{
+				key_codec.write(current, tree._keys[position]);
+				value_codec.write(current, tree._values[position]);
+			}
+			page_starts.push_back(order.size());
+			payloads.push_back(current.str());
+			current.str({});
+
+			for (size_t i{ 0 }; i < count;)
+			{
+				if (depths[preorder[i]] != resident_depth)
+				{
+					++i;
+					continue;
+				}
+
+				size_t last{ i + 1 };
+				while (last < count && depths[preorder[last]] > resident_depth)
+				{
+					++last;
+				}
+
+				for (; i < last; ++i)
+				{
+					order.push_back(preorder[i]);
+					key_codec.write(current, tree._keys[preorder[i]]);
+					value_codec.write(current, tree._values[preorder[i]]);
+				}
+
+				if (static_cast<size_t>(current.tellp()) >= page_bytes)
+				{
+					page_starts.push_back(order.size());
+					payloads.push_back(current.str());
+					current.str({});
+				}
+			}
+
+			if (page_starts.back() != order.size())
+			{
+				page_starts.push_back(order.size());
+				payloads.push_back(current.str());
+			}
+
+			std::vector<uint64_t> positions(count);
+			for (size_t i{ 0 }; i < count; ++i)
+			{
+				positions[order[i]] = i;
+			}
+
+			std::vector<uint64_t> child_offsets{ 0 };
+			std::vector<uint64_t> childs;
+			childs.reserve(tree._childs.size());
+			child_offsets.reserve(count + 1);
+			for (size_t i{ 0 }; i < count; ++i)
+			{
+				for (Index child{ tree._child_offsets[order[i]] }; child < tree._child_offsets[order[i] + 1]; ++child)
+				{
+					childs.push_back(positions[tree._childs[child]]);
+				}
+				child_offsets.push_back(childs.size());
+			}
+
+			size_t slot_count{ 2 };
+			while (slot_count < 2 * count)
+			{
+				slot_count *= 2;
+			}
+
+			std::vector<uint64_t> slots(2 * slot_count, EMPTY);
+			for (size_t i{ 0 }; i < count; ++i)
+			{
+				uint64_t hash_value{ hasher(tree._keys[order[i]]) };
+				size_t slot{ hash_value & (slot_count - 1) };
+				while (slots[2 * slot + 1] != EMPTY)
+				{
+					slot = (slot + 1) & (slot_count - 1);
+				}
+				slots[2 * slot] = hash_value;
+				slots[2 * slot + 1] = i;
+			}
+
+			std::vector<uint64_t> page_offsets{ 0 };
+			for (const std::string& payload : payloads)
+			{
+				page_offsets.push_back(page_offsets.back() + payload.size());
+			}
+
+			paged_file_header header{ _PAGED_FILE_MAGIC, count, payloads.size(), slot_count, childs.size() };
+
+			std::ofstream out{ path, std::ios::binary | std::ios::trunc };
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			write_array(out, page_starts);
+			write_array(out, page_offsets);
+			write_array(out, child_offsets);
+			write_array(out, childs);
+			write_array(out, slots);
+			for (const std::string& payload : payloads)
+			{
+				out.write(payload.data(), payload.size());
+			}
+
+			if (!out.flush())
+			{
+				throw std::runtime_error{ "paged_hash_tree: cannot write file" };
+			}
+		}
+
+		T at(const K& key)
+		{
+			uint64_t position{ index(key) };
+			if (position == EMPTY)
+			{
+				throw std::out_of_range{ "paged_hash_tree: key not found" };
+			}
+
+			return value_at(position);
+		}
+
+		bool contains(const K& key)
+		{
+			return index(key) != EMPTY;
+		}
+
+		size_t child_count(const K& key)
+		{
+			uint64_t position{ index(key) };
+			return _child_offsets[position + 1] - _child_offsets[position];
+		}
+
+		template<typename Function>
+		void for_each_child(const K& key, Function&& function)
+		{
+			uint64_t position{ index(key) };
+			for (uint64_t i{ _child_offsets[position] }; i < _child_offsets[position + 1]; ++i)
+			{
+				page& child_page{ load(page_of(_childs[i])) };
+				size_t offset{ _childs[i] - _page_starts[page_of(_childs[i])] };
+				K child_key{ child_page.keys[offset] };
+				T child_value{ child_page.values[offset] };
+				function(child_key, child_value);
+			}
+		}
+
+		size_t size() const
+		{
+			return _header->size;
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		size_t page_count() const
+		{
+			return _pages.size();
+		}
+
+		size_t resident_pages() const
+		{
+			return _lru.size() + 1;
+		}
+
+		size_t resident_bytes() const
+		{
+			return _resident_bytes;
+		}
+
+		size_t budget() const
+		{
+			return _budget;
+		}
+
+		void set_budget(size_t budget)
+		{
+			_budget = budget;
+			evict();
+		}
+
+	private:
+		uint64_t index(const K& key)
+		{
+			if (size() == 0)
+			{
+				return EMPTY;
+			}
+
+			uint64_t hash_value{ _hasher(key) };
+			size_t mask{ _header->slot_count - 1 };
+			for (size_t slot{ hash_value & mask };; slot = (slot + 1) & mask)
+			{
+				uint64_t position{ _slots[2 * slot + 1] };
+				if (position == EMPTY)
+				{
+					return EMPTY;
+				}
+
+				if (_slots[2 * slot] == hash_value && _keyeq(key_at(position), key))
+				{
+					return position;
+				}
+			}
+		}
+
+		const K& key_at(uint64_t position)
+		{
+			size_t page_index{ page_of(position) };
+			return load(page_index).keys[position - _page_starts[page_index]];
+		}
+
+		const T& value_at(uint64_t position)
+		{
+			size_t page_index{ page_of(position) };
+			return load(page_index).values[position - _page_starts[page_index]];
+		}
+
+		size_t page_of(uint64_t position) const
+		{
+			const uint64_t* end{ _page_starts + _pages.size() + 1 };
+			return std::upper_bound(_page_starts, end, position) - _page_starts - 1;
+		}
+
+		page& load(size_t page_index)
+		{
+			page& target{ _pages[page_index] };
+			if (target.loaded)
+			{
+				if (page_index != 0)
+				{
+					_lru.splice(_lru.begin(), _lru, target.lru);
+				}
+				return target;
+			}
+
+			size_t count{ _page_starts[page_index + 1] - _page_starts[page_index] };
+			size_t payload_size{ _page_offsets[page_index + 1] - _page_offsets[page_index] };
+			memory_streambuf buffer{ _payload + _page_offsets[page_index], payload_size };
+			std::istream in{ &buffer };
+
+			target.keys.reserve(count);
+			target.values.reserve(count);
+			for (size_t i{ 0 }; i < count; ++i)
+			{
+				target.keys.push_back(_key_codec.read(in));
+				target.values.push_back(_value_codec.read(in));
+			}
+
+			if (!in)
+			{
+				target.keys = {};
+				target.values = {};
+				throw std::runtime_error{ "paged_hash_tree: corrupt page" };
+			}
+
+			target.bytes = payload_size + count * (sizeof(K) + sizeof(T));
+			target.loaded = true;
+			_resident_bytes += target.bytes;
+
+			if (page_index != 0)
+			{
+				_lru.push_front(page_index);
+				target.lru = _lru.begin();
+				evict();
+			}
+
+			return target;
+		}
+
+		void evict()
+		{
+			while (_resident_bytes > _budget && _lru.size() > 1)
+			{
+				page& victim{ _pages[_lru.back()] };
+				_lru.pop_back();
+
+				_resident_bytes -= victim.bytes;
+				victim.keys = {};
+				victim.values = {};
+				victim.bytes = 0;
+				victim.loaded = false;
+			}
+		}
+
+		void bind()
+		{
+			const char* base{ static_cast<const char*>(_file) };
+			_header = reinterpret_cast<const paged_file_header*>(base);
+
+			size_t offset{ sizeof(paged_file_header) };
+			auto section = [&](size_t count)
+				{
+					const uint64_t* out{ reinterpret_cast<const uint64_t*>(base + offset) };
+					offset += count * sizeof(uint64_t);
+					return out;
+				};
+
+			if (_header->magic != _PAGED_FILE_MAGIC)
+			{
+				throw std::runtime_error{ "paged_hash_tree: not a paged_hash_tree file" };
+			}
+
+			_page_starts = section(_header->page_count + 1);
+			_page_offsets = section(_header->page_count + 1);
+			_child_offsets = section(_header->size + 1);
+			_childs = section(_header->child_count);
+			_slots = section(2 * _header->slot_count);
+			_payload = base + offset;
+
+			if (offset > _file_size || offset + _page_offsets[_header->page_count] > _file_size)
+			{
+				throw std::runtime_error{ "paged_hash_tree: truncated file" };
+			}
+
+			_pages.resize(_header->page_count);
+		}
+
+		static void write_array(std::ostream& out, const std::vector<uint64_t>& values)
+		{
+			out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(uint64_t));
+		}
+	};
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,597 @@
+#ifndef BYTE_PERSISTENTHASHTREE_H
+#define BYTE_PERSISTENTHASHTREE_H
+
+#include "hash_tree_hash.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	template<typename K, typename V, typename Hasher, typename Keyeq>
+	class hamt
+	{
+	private:
+		inline static constexpr size_t BITS{ 5 };
+		inline static constexpr size_t MASK{ (1ULL << BITS) - 1 };
+		inline static constexpr size_t MAX_SHIFT{ std::numeric_limits<size_t>::digits };
+
+		struct node;
+		using node_ptr = std::shared_ptr<const node>;
+
+		struct entry
+		{
+			size_t hash_value;
+			K key;
+			V value;
+			node_ptr child;
+		};
+
+		struct node
+		{
+			uint32_t bitmap{ 0 };
+			std::vector<entry> entries;
+		};
+
+	private:
+		node_ptr _root;
+		Hasher _hasher;
+		Keyeq _keyeq;
+
+	public:
+		const V* find(const K& key) const
+		{
+			size_t hash_value{ _hasher(key) };
+			const node* it{ _root.get() };
+
+			for (size_t shift{ 0 }; it; shift += BITS)
+			{
+				if (shift >= MAX_SHIFT)
+				{
+					for (const entry& e : it->entries)
+					{
+						if (_keyeq(e.key, key))
+						{
+							return &e.value;
+						}
+					}
+					return nullptr;
+				}
+
+				uint32_t bit{ 1U << ((hash_value >> shift) & MASK) };
+				if (!(it->bitmap & bit))
+				{
+					return nullptr;
+				}
+
+				const entry& e{ it->entries[std::popcount(it->bitmap & (bit - 1))] };
+				if (!e.child)
+				{
+					return e.hash_value == hash_value && _keyeq(e.key, key) ? &e.value : nullptr;
+				}
+				it = e.child.get();
+			}
+
+			return nullptr;
+		}
+
+		hamt assoc(const K& key, V value) const
+		{
+			hamt out{ *this };
+			out._root = assoc(_root, 0, _hasher(key), key, std::move(value));
+			return out;
+		}
+
+		hamt dissoc(const K& key) const
+		{
+			hamt out{ *this };
+			out._root = dissoc(_root, 0, _hasher(key), key);
+			return out;
+		}
+
+	private:
+		node_ptr assoc(const node_ptr& current, size_t shift, size_t hash_value, const K& key, V&& value) const
+		{
+			if (!current)
+			{
+				auto out{ std::make_shared<node>() };
+				if (shift < MAX_SHIFT)
+				{
+					out->bitmap = 1U << ((hash_value >> shift) & MASK);
+				}
+				out->entries.push_back(entry{ hash_value, key, std::move(value), nullptr });
+				return out;
+			}
+
+			auto out{ std::make_shared<node>(*current) };
+
+			if (shift >= MAX_SHIFT)
+			{
+				for (entry& e : out->entries)
+				{
+					if (_keyeq(e.key, key))
+					{
+						e.value = std::move(value);
+						return out;
+					}
+				}
+				out->entries.push_back(entry{ hash_value, key, std::move(value), nullptr });
+				return out;
+			}
+
+			uint32_t bit{ 1U << ((hash_value >> shift) & MASK) };
+			size_t position{ static_cast<size_t>(std::popcount(current->bitmap & (bit - 1))) };
+
+			if (!(current->bitmap & bit))
+			{
+				out->bitmap |= bit;
+				out->entries.insert(out->entries.begin() + position, entry{ hash_value, key, std::move(value), nullptr });
+				return out;
+			}
+
+			entry& e{ out->entries[position] };
+			if (e.child)
+			{
+				e.child = assoc(e.child, shift + BITS, hash_value, key, std::move(value));
+			}
+			else if (e.hash_value == hash_value && _keyeq(e.key, key))
+			{
+				e.value = std::move(value);
+			}
+			else
+			{
+				node_ptr child{ assoc(nullptr, shift + BITS, e.hash_value, e.key, std::move(e.value)) };
+				e.child = assoc(child, shift + BITS, hash_value, key, std::move(value));
+			}
+
+			return out;
+		}
+
+		node_ptr dissoc(const node_ptr& current, size_t shift, size_t hash_value, const K& key) const
+		{
+			if (!current)
+			{
+				return current;
+			}
+
+			if (shift >= MAX_SHIFT)
+			{
+				auto it{ std::find_if(current->entries.begin(), current->entries.end(), [&](const entry& e) { return _keyeq(e.key, key); }) };
+				if (it == current->entries.end())
+				{
+					return current;
+				}
+				if (current->entries.size() == 1)
+				{
+					return nullptr;
+				}
+
+				auto out{ std::make_shared<node>(*current) };
+				out->entries.erase(out->entries.begin() + (it - current->entries.begin()));
+				return out;
+			}
+
+			uint32_t bit{ 1U << ((hash_value >> shift) & MASK) };
+			if (!(current->bitmap & bit))
+			{
+				return current;
+			}
+
+			size_t position{ static_cast<size_t>(std::popcount(current->bitmap & (bit - 1))) };
+			const entry& e{ current->entries[position] };
+
+			node_ptr child{ nullptr };
+			if (e.child)
+			{
+				child = dissoc(e.child, shift + BITS, hash_value, key);
+				if (child == e.child)
+				{
+					return current;
+				}
+			}
+			else if (e.hash_value != hash_value || !_keyeq(e.key, key))
+			{
+				return current;
+			}
+
+			if (!child && current->entries.size() == 1)
+			{
+				return nullptr;
+			}
+
+			auto out{ std::make_shared<node>(*current) };
+			if (child)
+			{
+				out->entries[position].child = std::move(child);
+			}
+			else
+			{
+				out->bitmap &= ~bit;
+				out->entries.erase(out->entries.begin() + position);
+			}
+			return out;
+		}
+	};
+
+	template<typename K, typename T>
+	struct persistent_hash_tree_record
+	{
+		std::shared_ptr<const T> value;
+		std::optional<K> parent{};
+		std::optional<K> first_child{};
+		std::optional<K> last_child{};
+		std::optional<K> prev_sibling{};
+		std::optional<K> next_sibling{};
+		size_t child_count{ 0 };
+	};
+
+	template<typename Tree, typename T>
+	class persistent_hash_tree_iterator
+	{
+	private:
+		using record_type = typename Tree::record_type;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+	private:
+		const Tree* _tree;
+		std::vector<const record_type*> _visit;
+		size_t _index;
+
+	public:
+		persistent_hash_tree_iterator(const Tree* tree, const record_type* head, size_t index)
+			:_tree{ tree }, _index{ index }
+		{
+			if (head)
+			{
+				_visit.reserve(tree->size());
+				_visit.push_back(head);
+			}
+		}
+
+		reference operator*() const
+		{
+			return *_visit[_index]->value;
+		}
+
+		pointer operator->() const
+		{
+			return _visit[_index]->value.get();
+		}
+
+		persistent_hash_tree_iterator& operator++()
+		{
+			for (const record_type* child{ child_of(_visit[_index]->first_child) }; child; child = child_of(child->next_sibling))
+			{
+				_visit.push_back(child);
+			}
+			++_index;
+
+			return *this;
+		}
+
+		persistent_hash_tree_iterator operator++(int)
+		{
+			persistent_hash_tree_iterator out{ *this };
+			++(*this);
+			return out;
+		}
+
+		bool operator==(const persistent_hash_tree_iterator& left) const
+		{
+			return _index == left._index;
+		}
+
+		bool operator!=(const persistent_hash_tree_iterator& left) const
+		{
+			return _index != left._index;
+		}
+
+	private:
+		const record_type* child_of(const std::optional<typename Tree::key_type>& key) const
+		{
+			return key ? _tree->record(*key) : nullptr;
+		}
+	};
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>>
+	class persistent_hash_tree
+	{
+	public:
+		using record_type = persistent_hash_tree_record<K, T>;
+
+	private:
+		using record_ptr = std::shared_ptr<const record_type>;
+		using record_map = hamt<K, record_ptr, Hasher, Keyeq>;
+
+		template<typename, typename>
+		friend class persistent_hash_tree_iterator;
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+
+		using iterator = persistent_hash_tree_iterator<persistent_hash_tree, T>;
+		using const_iterator = iterator;
+
+	private:
+		record_map _records;
+		std::optional<K> _head;
+		size_t _size{ 0 };
+		Keyeq _keyeq;
+
+	public:
+		[[nodiscard]] persistent_hash_tree insert(const K& key, T value) const
+		{
+			if (contains(key))
+			{
+				return assign(key, std::move(value));
+			}
+
+			if (!_head)
+			{
+				persistent_hash_tree out{ *this };
+				out._records = _records.assoc(key, std::make_shared<const record_type>(record_type{ std::make_shared<const T>(std::move(value)) }));
+				out._head = key;
+				out._size = 1;
+				return out;
+			}
+
+			return insert(key, std::move(value), *_head);
+		}
+
+		[[nodiscard]] persistent_hash_tree insert(const K& key, T value, const K& parent) const
+		{
+			if (contains(key))
+			{
+				return assign(key, std::move(value));
+			}
+
+			persistent_hash_tree out{ *this };
+			out.link(key, record_type{ std::make_shared<const T>(std::move(value)) }, parent, std::numeric_limits<size_t>::max());
+			++out._size;
+			return out;
+		}
+
+		[[nodiscard]] persistent_hash_tree erase(const K& key) const
+		{
+			if (!contains(key))
+			{
+				return *this;
+			}
+
+			if (_keyeq(key, *_head))
+			{
+				return persistent_hash_tree{};
+			}
+
+			persistent_hash_tree out{ *this };
+			out.unlink(key);
+
+			std::vector<K> visit{ key };
+			while (!visit.empty())
+			{
+				K current{ std::move(visit.back()) };
+				visit.pop_back();
+
+				for (std::optional<K> child{ record(current)->first_child }; child; child = record(*child)->next_sibling)
+				{
+					visit.push_back(*child);
+				}
+
+				out._records = out._records.dissoc(current);
+				--out._size;
+			}
+
+			return out;
+		}
+
+		[[nodiscard]] persistent_hash_tree set_parent(const K& key, const K& new_parent) const
+		{
+			return set_parent(key, new_parent, std::numeric_limits<size_t>::max());
+		}
+
+		[[nodiscard]] persistent_hash_tree set_parent(const K& key, const K& new_parent, size_t position) const
+		{
+			existing(key);
+			existing(new_parent);
+
+			persistent_hash_tree out{ *this };
+			out.link(key, out.unlink(key), new_parent, position);
+			return out;
+		}
+
+		[[nodiscard]] persistent_hash_tree assign(const K& key, T value) const
+		{
+			record_type current{ existing(key) };
+			current.value = std::make_shared<const T>(std::move(value));
+
+			persistent_hash_tree out{ *this };
+			out.store(key, std::move(current));
+			return out;
+		}
+
+		const T& at(const K& key) const
+		{
+			return *existing(key).value;
+		}
+
+		const T& operator[](const K& key) const
+		{
+			return at(key);
+		}
+
+		bool contains(const K& key) const
+		{
+			return _records.find(key) != nullptr;
+		}
+
+		size_t child_count(const K& key) const
+		{
+			return existing(key).child_count;
+		}
+
+		iterator begin() const
+		{
+			return iterator{ this, _head ? record(*_head) : nullptr, 0 };
+		}
+
+		iterator end() const
+		{
+			return iterator{ this, nullptr, size() };
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+
+		bool empty() const
+		{
+			return _size == 0;
+		}
+
+	private:
+		const record_type* record(const K& key) const
+		{
+			const record_ptr* it{ _records.find(key) };
+			return it ? it->get() : nullptr;
+		}
+
+		const record_type& existing(const K& key) const
+		{
+			const record_type* found{ record(key) };
+			if (!found)
+			{
+				throw std::out_of_range{ "persistent_hash_tree: key not found" };
+			}
+
+			return *found;
+		}
+
+		void store(const K& key, record_type&& updated)
+		{
+			_records = _records.assoc(key, std::make_shared<const record_type>(std::move(updated)));
+		}
+
+		void link(const K& key, record_type&& linked, const K& parent, size_t position)
+		{
+			record_type parent_record{ existing(parent) };
+			position = std::min(position, parent_record.child_count);
+
+			std::optional<K> next;
+			if (position < parent_record.child_count / 2)
+			{
+				next = parent_record.first_child;
+				for (; position != 0; --position)
+				{
+					next = record(*next)->next_sibling;
+				}
+			}
+			else if (position != parent_record.child_count)
+			{
+				next = parent_record.last_child;
+				for (size_t back{ parent_record.child_count - 1 }; back != position; --back)
+				{
+					next = record(*next)->prev_sibling;
+				}
+			}
+
+			std::optional<K> prev{ next ? record(*next)->prev_sibling : parent_record.last_child };
+
+			linked.parent = parent;
+			linked.prev_sibling = prev;
+			linked.next_sibling = next;
+
+			if (prev)
+			{
+				record_type prev_record{ *record(*prev) };
+				prev_record.next_sibling = key;
+				store(*prev, std::move(prev_record));
+			}
+			else
+			{
+				parent_record.first_child = key;
+			}
+
+			if (next)
+			{
+				record_type next_record{ *record(*next) };
+				next_record.prev_sibling = key;
+				store(*next, std::move(next_record));
+			}
+			else
+			{
+				parent_record.last_child = key;
+			}
+
+			++parent_record.child_count;
+			store(parent, std::move(parent_record));
+			store(key, std::move(linked));
+		}
+
+		record_type unlink(const K& key)
+		{
+			record_type unlinked{ *record(key) };
+			if (!unlinked.parent)
+			{
+				return unlinked;
+			}
+
+			record_type parent_record{ *record(*unlinked.parent) };
+			if (unlinked.prev_sibling)
+			{
+				record_type prev_record{ *record(*unlinked.prev_sibling) };
+				prev_record.next_sibling = unlinked.next_sibling;
+				store(*unlinked.prev_sibling, std::move(prev_record));
+			}
+			else
+			{
+				parent_record.first_child = unlinked.next_sibling;
+			}
+
+			if (unlinked.next_sibling)
+			{
+				record_type next_record{ *record(*unlinked.next_sibling) };
+				next_record.prev_sibling = unlinked.prev_sibling;
+				store(*unlinked.next_sibling, std::move(next_record));
+			}
+			else
+			{
+				parent_record.last_child = unlinked.prev_sibling;
+			}
+
+			--parent_record.child_count;
+			store(*unlinked.parent, std::move(parent_record));
+
+			unlinked.parent.reset();
+			unlinked.prev_sibling.reset();
+			unlinked.next_sibling.reset();
+			return unlinked;
+		}
+	};
+
+}
+
+#endif
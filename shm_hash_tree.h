@@ -0,0 +1,694 @@
+#ifndef BYTE_SHMHASHTREE_H
+#define BYTE_SHMHASHTREE_H
+
+#include "frozen_hash_tree.h"
+#include "hash_tree_codec.h"
+
+#if __has_include(<sys/mman.h>)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	struct shm_control
+	{
+		std::atomic<uint64_t> generation;
+	};
+
+	struct shm_image_header
+	{
+		uint64_t magic;
+		uint64_t key_size;
+		uint64_t value_size;
+		uint64_t index_size;
+		uint64_t size;
+		uint64_t key_bytes;
+		uint64_t value_bytes;
+		uint64_t child_count;
+		uint64_t bucket_count;
+		uint64_t slot_count;
+	};
+
+	inline constexpr uint64_t _SHM_IMAGE_MAGIC{ 0x4259544548545246ULL };
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t,
+		typename KeyCodec = codec<K>,
+		typename ValueCodec = codec<T>>
+	class shm_hash_tree
+	{
+	private:
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "shm_hash_tree needs lock-free 64-bit atomics");
+
+		inline static constexpr Index EMPTY{ std::numeric_limits<Index>::max() };
+
+		template<typename V, typename Codec>
+		struct column
+		{
+			inline static constexpr bool DIRECT{ std::is_trivially_copyable<V>::value };
+			inline static constexpr uint64_t ELEMENT_SIZE{ DIRECT ? sizeof(V) : 0 };
+			inline static constexpr size_t ALIGNMENT{ DIRECT ? alignof(V) : alignof(uint64_t) };
+
+			using reference = std::conditional_t<DIRECT, const V&, V>;
+
+			const uint64_t* offsets{ nullptr };
+			const char* data{ nullptr };
+			uint64_t bytes{ 0 };
+
+			static size_t table_size(size_t count)
+			{
+				return DIRECT ? 0 : (count + 1) * sizeof(uint64_t);
+			}
+
+			static uint64_t byte_size(const std::vector<V>& source, const Codec& codec)
+			{
+				if constexpr (DIRECT)
+				{
+					return source.size() * sizeof(V);
+				}
+				else
+				{
+					counting_streambuf counter;
+					std::ostream out{ &counter };
+					for (const V& value : source)
+					{
+						codec.write(out, value);
+					}
+					return counter.count();
+				}
+			}
+
+			static void write(char* destination, const std::vector<V>& source, uint64_t bytes, const Codec& codec)
+			{
+				if constexpr (DIRECT)
+				{
+					if (!source.empty())
+					{
+						std::memcpy(destination, source.data(), bytes);
+					}
+				}
+				else
+				{
+					uint64_t* table{ reinterpret_cast<uint64_t*>(destination) };
+					span_streambuf buffer{ destination + table_size(source.size()), bytes };
+					std::ostream out{ &buffer };
+					for (size_t position{ 0 }; position < source.size(); ++position)
+					{
+						table[position] = buffer.count();
+						codec.write(out, source[position]);
+					}
+					table[source.size()] = buffer.count();
+				}
+			}
+
+			bool bind(const char* base, size_t count, uint64_t byte_count)
+			{
+				offsets = reinterpret_cast<const uint64_t*>(base);
+				data = base + table_size(count);
+				bytes = byte_count;
+
+				if constexpr (DIRECT)
+				{
+					return bytes == count * sizeof(V);
+				}
+				else
+				{
+					return offsets[0] == 0 && offsets[count] == bytes;
+				}
+			}
+
+			reference at(size_t position, const Codec& codec) const
+			{
+				if constexpr (DIRECT)
+				{
+					return reinterpret_cast<const V*>(data)[position];
+				}
+				else
+				{
+					if (offsets[position] > offsets[position + 1] || offsets[position + 1] > bytes)
+					{
+						throw std::runtime_error{ "shm_hash_tree: image has corrupt offsets" };
+					}
+
+					memory_streambuf buffer{ data + offsets[position], offsets[position + 1] - offsets[position] };
+					std::istream in{ &buffer };
+					return codec.read(in);
+				}
+			}
+		};
+
+		class counting_streambuf : public std::streambuf
+		{
+		private:
+			uint64_t _count{ 0 };
+
+		public:
+			uint64_t count() const
+			{
+				return _count;
+			}
+
+		protected:
+			std::streamsize xsputn(const char*, std::streamsize count) override
+			{
+				_count += count;
+				return count;
+			}
+
+			int_type overflow(int_type value) override
+			{
+				++_count;
+				return traits_type::not_eof(value);
+			}
+		};
+
+		class span_streambuf : public std::streambuf
+		{
+		public:
+			span_streambuf(char* data, size_t size)
+			{
+				setp(data, data + size);
+			}
+
+			uint64_t count() const
+			{
+				return pptr() - pbase();
+			}
+		};
+
+		using key_column = column<K, KeyCodec>;
+		using value_column = column<T, ValueCodec>;
+
+		struct layout
+		{
+			size_t keys;
+			size_t values;
+			size_t child_offsets;
+			size_t childs;
+			size_t displacements;
+			size_t slots;
+			size_t size;
+
+			explicit layout(const shm_image_header& header)
+			{
+				keys = align(sizeof(shm_image_header), key_column::ALIGNMENT);
+				values = align(keys + key_column::table_size(header.size) + header.key_bytes, value_column::ALIGNMENT);
+				child_offsets = align(values + value_column::table_size(header.size) + header.value_bytes, alignof(Index));
+				childs = child_offsets + (header.size + 1) * sizeof(Index);
+				displacements = align(childs + header.child_count * sizeof(Index), alignof(uint32_t));
+				slots = align(displacements + header.bucket_count * sizeof(uint32_t), alignof(Index));
+				size = slots + header.slot_count * sizeof(Index);
+			}
+
+			static size_t align(size_t offset, size_t alignment)
+			{
+				return (offset + alignment - 1) / alignment * alignment;
+			}
+		};
+
+		class value_iterator
+		{
+		private:
+			const shm_hash_tree* _tree{ nullptr };
+			size_t _position{ 0 };
+
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = T;
+
+			value_iterator() = default;
+
+			value_iterator(const shm_hash_tree* tree, size_t position)
+				:_tree{ tree }, _position{ position }
+			{
+			}
+
+			T operator*() const
+			{
+				return _tree->_values.at(_position, _tree->_value_codec);
+			}
+
+			value_iterator& operator++()
+			{
+				++_position;
+				return *this;
+			}
+
+			value_iterator operator++(int)
+			{
+				value_iterator out{ *this };
+				++_position;
+				return out;
+			}
+
+			bool operator==(const value_iterator& left) const
+			{
+				return _position == left._position;
+			}
+
+			bool operator!=(const value_iterator& left) const
+			{
+				return _position != left._position;
+			}
+		};
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+		using index_type = Index;
+		using frozen_type = frozen_hash_tree<K, T, Hasher, Keyeq, Index>;
+		using key_reference = typename key_column::reference;
+		using value_reference = typename value_column::reference;
+
+		using iterator = std::conditional_t<value_column::DIRECT, const T*, value_iterator>;
+		using const_iterator = iterator;
+
+	private:
+		std::string _name;
+		shm_control* _control{ nullptr };
+		void* _image{ nullptr };
+		size_t _image_size{ 0 };
+		uint64_t _generation{ 0 };
+
+		const shm_image_header* _header{ nullptr };
+		key_column _keys;
+		value_column _values;
+		const Index* _child_offsets{ nullptr };
+		const Index* _childs{ nullptr };
+		const uint32_t* _displacements{ nullptr };
+		const Index* _slots{ nullptr };
+		Hasher _hasher;
+		Keyeq _keyeq;
+		KeyCodec _key_codec;
+		ValueCodec _value_codec;
+
+	public:
+		shm_hash_tree() = default;
+
+		shm_hash_tree(const shm_hash_tree& left) = delete;
+
+		shm_hash_tree(shm_hash_tree&& right) noexcept
+		{
+			swap(right);
+		}
+
+		shm_hash_tree& operator=(const shm_hash_tree& left) = delete;
+
+		shm_hash_tree& operator=(shm_hash_tree&& right) noexcept
+		{
+			if (this != &right)
+			{
+				shm_hash_tree temp{ std::move(right) };
+				swap(temp);
+			}
+
+			return *this;
+		}
+
+		~shm_hash_tree()
+		{
+			detach();
+		}
+
+		static uint64_t publish(
+			const std::string& name,
+			const frozen_type& tree,
+			const KeyCodec& key_codec = {},
+			const ValueCodec& value_codec = {})
+		{
+			int control_fd{ ::shm_open(name.c_str(), O_RDWR | O_CREAT, 0644) };
+			if (control_fd < 0 || ::ftruncate(control_fd, sizeof(shm_control)) != 0)
+			{
+				close_fd(control_fd);
+				throw std::runtime_error{ "shm_hash_tree: cannot open control segment" };
+			}
+
+			void* control_memory{ ::mmap(nullptr, sizeof(shm_control), PROT_READ | PROT_WRITE, MAP_SHARED, control_fd, 0) };
+			::close(control_fd);
+			if (control_memory == MAP_FAILED)
+			{
+				throw std::runtime_error{ "shm_hash_tree: cannot map control segment" };
+			}
+
+			shm_control* control{ static_cast<shm_control*>(control_memory) };
+			uint64_t generation{ control->generation.load(std::memory_order_acquire) + 1 };
+
+			shm_image_header header{
+				_SHM_IMAGE_MAGIC,
+				key_column::ELEMENT_SIZE,
+				value_column::ELEMENT_SIZE,
+				sizeof(Index),
+				tree.size(),
+				key_column::byte_size(tree._keys, key_codec),
+				value_column::byte_size(tree._values, value_codec),
+				tree._childs.size(),
+				tree._displacements.size(),
+				tree._slots.size() };
+			layout offsets{ header };
+
+			std::string data_name{ segment_name(name, generation) };
+			int fd{ ::shm_open(data_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) };
+			void* image{ MAP_FAILED };
+			if (fd >= 0 && ::ftruncate(fd, offsets.size) == 0)
+			{
+				image = ::mmap(nullptr, offsets.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			}
+			close_fd(fd);
+
+			if (image == MAP_FAILED)
+			{
+				::shm_unlink(data_name.c_str());
+				::munmap(control_memory, sizeof(shm_control));
+				throw std::runtime_error{ "shm_hash_tree: cannot create image segment" };
+			}
+
+			char* base{ static_cast<char*>(image) };
+			std::memcpy(base, &header, sizeof(header));
+			key_column::write(base + offsets.keys, tree._keys, header.key_bytes, key_codec);
+			value_column::write(base + offsets.values, tree._values, header.value_bytes, value_codec);
+			copy(base + offsets.child_offsets, tree._child_offsets);
+			copy(base + offsets.childs, tree._childs);
+			copy(base + offsets.displacements, tree._displacements);
+			copy(base + offsets.slots, tree._slots);
+			::munmap(image, offsets.size);
+
+			control->generation.store(generation, std::memory_order_release);
+			::munmap(control_memory, sizeof(shm_control));
+
+			if (generation > 1)
+			{
+				::shm_unlink(segment_name(name, generation - 1).c_str());
+			}
+
+			return generation;
+		}
+
+		static shm_hash_tree attach(
+			const std::string& name,
+			const Hasher& hasher = {},
+			const Keyeq& keyeq = {},
+			const KeyCodec& key_codec = {},
+			const ValueCodec& value_codec = {})
+		{
+			shm_hash_tree out;
+			out._name = name;
+			out._hasher = hasher;
+			out._keyeq = keyeq;
+			out._key_codec = key_codec;
+			out._value_codec = value_codec;
+
+			int control_fd{ ::shm_open(name.c_str(), O_RDONLY, 0) };
+			if (control_fd < 0)
+			{
+				throw std::runtime_error{ "shm_hash_tree: no tree is published under this name" };
+			}
+
+			void* control_memory{ ::mmap(nullptr, sizeof(shm_control), PROT_READ, MAP_SHARED, control_fd, 0) };
+			::close(control_fd);
+			if (control_memory == MAP_FAILED)
+			{
+				throw std::runtime_error{ "shm_hash_tree: cannot map control segment" };
+			}
+			out._control = static_cast<shm_control*>(control_memory);
+
+			while (true)
+			{
+				uint64_t generation{ out._control->generation.load(std::memory_order_acquire) };
+				if (generation == 0)
+				{
+					throw std::runtime_error{ "shm_hash_tree: no tree is published under this name" };
+				}
+
+				int fd{ ::shm_open(segment_name(name, generation).c_str(), O_RDONLY, 0) };
+				if (fd < 0 && errno == ENOENT && out._control->generation.load(std::memory_order_acquire) != generation)
+				{
+					continue;
+				}
+
+				struct stat status;
+				if (fd < 0 || ::fstat(fd, &status) != 0)
+				{
+					close_fd(fd);
+					throw std::runtime_error{ "shm_hash_tree: cannot open image segment" };
+				}
+
+				void* image{ ::mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0) };
+				::close(fd);
+				if (image == MAP_FAILED)
+				{
+					throw std::runtime_error{ "shm_hash_tree: cannot map image segment" };
+				}
+
+				out._image = image;
+				out._image_size = status.st_size;
+				out._generation = generation;
+				break;
+			}
+
+			out.bind();
+			return out;
+		}
+
+		static void remove(const std::string& name)
+		{
+			int control_fd{ ::shm_open(name.c_str(), O_RDONLY, 0) };
+			if (control_fd < 0)
+			{
+				return;
+			}
+
+			void* control_memory{ ::mmap(nullptr, sizeof(shm_control), PROT_READ, MAP_SHARED, control_fd, 0) };
+			::close(control_fd);
+			if (control_memory != MAP_FAILED)
+			{
+				uint64_t generation{ static_cast<shm_control*>(control_memory)->generation.load(std::memory_order_acquire) };
+				::shm_unlink(segment_name(name, generation).c_str());
+				::munmap(control_memory, sizeof(shm_control));
+			}
+			::shm_unlink(name.c_str());
+		}
+
+		bool stale() const
+		{
+			return _control && _control->generation.load(std::memory_order_acquire) != _generation;
+		}
+
+		void refresh()
+		{
+			if (stale())
+			{
+				*this = attach(_name, _hasher, _keyeq, _key_codec, _value_codec);
+			}
+		}
+
+		uint64_t generation() const
+		{
+			return _generation;
+		}
+
+		value_reference at(const K& key) const
+		{
+			return _values.at(index(key), _value_codec);
+		}
+
+		value_reference operator[](const K& key) const
+		{
+			return at(key);
+		}
+
+		bool contains(const K& key) const
+		{
+			return index(key) != EMPTY;
+		}
+
+		size_t child_count(const K& key) const
+		{
+			Index position{ index(key) };
+			return _child_offsets[position + 1] - _child_offsets[position];
+		}
+
+		template<typename Function>
+		void for_each_child(const K& key, Function&& function) const
+		{
+			Index position{ index(key) };
+			for (Index i{ _child_offsets[position] }; i < _child_offsets[position + 1]; ++i)
+			{
+				function(_keys.at(_childs[i], _key_codec), _values.at(_childs[i], _value_codec));
+			}
+		}
+
+		const_iterator begin() const
+		{
+			return iterator_at(0);
+		}
+
+		const_iterator end() const
+		{
+			return iterator_at(size());
+		}
+
+		size_t size() const
+		{
+			return _header ? _header->size : 0;
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+	private:
+		Index index(const K& key) const
+		{
+			if (!_header || _header->slot_count == 0)
+			{
+				return EMPTY;
+			}
+
+			size_t hash_value{ _hasher(key) };
+			uint32_t displacement{ _displacements[hash_value % _header->bucket_count] };
+			Index position{ _slots[_mix_hash(hash_value, displacement) % _header->slot_count] };
+
+			if (position != EMPTY && _keyeq(_keys.at(position, _key_codec), key))
+			{
+				return position;
+			}
+
+			return EMPTY;
+		}
+
+		void bind()
+		{
+			const char* base{ static_cast<const char*>(_image) };
+			_header = reinterpret_cast<const shm_image_header*>(base);
+
+			if (_image_size < sizeof(shm_image_header)
+				|| _header->magic != _SHM_IMAGE_MAGIC
+				|| _header->key_size != key_column::ELEMENT_SIZE
+				|| _header->value_size != value_column::ELEMENT_SIZE
+				|| _header->index_size != sizeof(Index)
+				|| layout{ *_header }.size > _image_size)
+			{
+				detach();
+				throw std::runtime_error{ "shm_hash_tree: image does not match this tree type" };
+			}
+
+			layout offsets{ *_header };
+			if (!_keys.bind(base + offsets.keys, _header->size, _header->key_bytes)
+				|| !_values.bind(base + offsets.values, _header->size, _header->value_bytes))
+			{
+				detach();
+				throw std::runtime_error{ "shm_hash_tree: image has corrupt offsets" };
+			}
+
+			_child_offsets = reinterpret_cast<const Index*>(base + offsets.child_offsets);
+			_childs = reinterpret_cast<const Index*>(base + offsets.childs);
+			_displacements = reinterpret_cast<const uint32_t*>(base + offsets.displacements);
+			_slots = reinterpret_cast<const Index*>(base + offsets.slots);
+		}
+
+		void detach()
+		{
+			if (_image)
+			{
+				::munmap(_image, _image_size);
+			}
+
+			if (_control)
+			{
+				::munmap(_control, sizeof(shm_control));
+			}
+
+			_image = nullptr;
+			_control = nullptr;
+			_header = nullptr;
+		}
+
+		void swap(shm_hash_tree& right) noexcept
+		{
+			std::swap(_name, right._name);
+			std::swap(_control, right._control);
+			std::swap(_image, right._image);
+			std::swap(_image_size, right._image_size);
+			std::swap(_generation, right._generation);
+			std::swap(_header, right._header);
+			std::swap(_keys, right._keys);
+			std::swap(_values, right._values);
+			std::swap(_child_offsets, right._child_offsets);
+			std::swap(_childs, right._childs);
+			std::swap(_displacements, right._displacements);
+			std::swap(_slots, right._slots);
+			std::swap(_hasher, right._hasher);
+			std::swap(_keyeq, right._keyeq);
+			std::swap(_key_codec, right._key_codec);
+			std::swap(_value_codec, right._value_codec);
+		}
+
+		const_iterator iterator_at(size_t position) const
+		{
+			if constexpr (value_column::DIRECT)
+			{
+				return reinterpret_cast<const T*>(_values.data) + position;
+			}
+			else
+			{
+				return value_iterator{ this, position };
+			}
+		}
+
+		template<typename Container>
+		static void copy(char* destination, const Container& source)
+		{
+			if (!source.empty())
+			{
+				std::memcpy(destination, source.data(), source.size() * sizeof(typename Container::value_type));
+			}
+		}
+
+		static void close_fd(int fd)
+		{
+			if (fd >= 0)
+			{
+				::close(fd);
+			}
+		}
+
+		static std::string segment_name(const std::string& name, uint64_t generation)
+		{
+			return name + "." + std::to_string(generation);
+		}
+	};
+
+}
+
+#endif
+
+#endif
@@ -37,7 +37,7 @@ namespace Byte
 		sparse_vector_iterator(T* data, size_t _index, bitset_vector* bitsets)
 			:data{ data }, _index{ _index }, bitsets_ptr{ bitsets }
 		{
-			if (bitsets_ptr && !bitsets_ptr->at(_index / _BITSET_SIZE).test(_BITSET_SIZE - 1ULL - _index % _BITSET_SIZE))
+			if (bitsets_ptr && _index < bitsets_ptr->size() * _BITSET_SIZE && !bitsets_ptr->at(_index / _BITSET_SIZE).test(_BITSET_SIZE - 1ULL - _index % _BITSET_SIZE))
 			{
 				++(*this);
 			}
@@ -59,8 +59,8 @@ namespace Byte
 			for (size_t bitset_index{ _index / _BITSET_SIZE }; bitset_index < bitsets_ptr->size(); ++bitset_index)
 			{
 				size_t _bitset{ bitsets_ptr->at(bitset_index).to_ullong() };
-				size_t bit_count{ _BITSET_SIZE - 1ULL - (_index % _BITSET_SIZE) };
-				size_t mask{ ((1ULL << bit_count)) };
+				size_t bit_count{ _BITSET_SIZE - (_index % _BITSET_SIZE) };
+				size_t mask{ bit_count == _BITSET_SIZE ? ~0ULL : (1ULL << bit_count) - 1ULL };
 
 				_bitset &= mask;
 
@@ -79,8 +79,9 @@ namespace Byte
 
 		sparse_vector_iterator operator++(int)
 		{
+			sparse_vector_iterator out{ *this };
 			++(*this);
-			return sparse_vector_iterator{ *this };
+			return out;
 		}
 
 		bool operator==(const sparse_vector_iterator& left) const
@@ -156,14 +157,19 @@ namespace Byte
 			right._capacity = 0;
 		}
 
-		sparse_vector& operator=(const sparse_vector left)
+		sparse_vector& operator=(const sparse_vector& left)
 		{
-			(*this) = left.copy();
+			if (this != &left)
+			{
+				(*this) = left.copy();
+			}
+
+			return *this;
 		}
 
 		sparse_vector& operator=(sparse_vector&& right) noexcept
 		{
-			clear();
+			release();
 
 			_data = right._data;
 			bitsets = std::move(right.bitsets);
@@ -175,6 +181,13 @@ namespace Byte
 			right._data = nullptr;
 			right._size = 0;
 			right._capacity = 0;
+
+			return *this;
+		}
+
+		~sparse_vector()
+		{
+			release();
 		}
 
 		[[maybe_unused]] size_t push(const T& value)
@@ -334,9 +347,11 @@ namespace Byte
 
 			for (; _begin != _end; ++_begin)
 			{
-				out_data[_begin.index()] = *_begin;
+				out.construct(out_data + _begin.index(), T{ *_begin });
 			}
 
+			allocator_traits::deallocate(out.allocator, out._data, out._capacity);
+
 			out._data = out_data;
 			out._size = _size;
 			out._capacity = _capacity;
@@ -344,6 +359,19 @@ namespace Byte
 			return out;
 		}
 
+		void reserve(size_t new_capacity)
+		{
+			if (new_capacity % _BITSET_SIZE != 0)
+			{
+				new_capacity += _BITSET_SIZE - (new_capacity % _BITSET_SIZE);
+			}
+
+			if (new_capacity > _capacity)
+			{
+				expand(new_capacity);
+			}
+		}
+
 		void shrink_to_fit()
 		{
 			if (empty())
@@ -373,31 +401,58 @@ namespace Byte
 			return _data;
 		}
 
-		const pointer data() const
+		const_pointer data() const
 		{
 			return _data;
 		}
 
 		bool test(size_t index) const
 		{
-			return bitsets[index / 64].test(index % 64);
+			return bitsets[index / _BITSET_SIZE].test(_BITSET_SIZE - 1ULL - index % _BITSET_SIZE);
 		}
 
 	private:
+		void release()
+		{
+			if (!std::is_trivially_destructible<T>::value)
+			{
+				for (auto& item : *this)
+				{
+					destroy(&item);
+				}
+			}
+
+			if (_data)
+			{
+				allocator_traits::deallocate(allocator, _data, _capacity);
+			}
+
+			_data = nullptr;
+			bitsets.clear();
+			indices.clear();
+			_size = 0;
+			_capacity = 0;
+		}
+
 		void expand(size_t new_capacity)
 		{
 			pointer temp{ _data };
 
 			_data = allocator_traits::allocate(allocator, new_capacity);
 
-			for (size_t index{ 0 }; index < _size; ++index)
+			iterator it{ temp, 0, &bitsets };
+			iterator _end{ temp, bitsets.size() * _BITSET_SIZE, nullptr };
+
+			for (; it != _end; ++it)
 			{
-				T& item{ temp[index] };
-				construct(_data + index, std::move(item));
-				destroy(temp + index);
+				construct(_data + it.index(), std::move(*it));
+				destroy(&*it);
 			}
 
-			allocator_traits::deallocate(allocator, temp, _capacity);
+			if (temp)
+			{
+				allocator_traits::deallocate(allocator, temp, _capacity);
+			}
 
 			for (size_t bitset_index{ _capacity / _BITSET_SIZE }; bitset_index < new_capacity / _BITSET_SIZE; ++bitset_index)
 			{
@@ -421,6 +476,7 @@ namespace Byte
 			for (; it != _end; ++it)
 			{
 				construct(_data + it.index(), std::move(*it));
+				destroy(&*it);
 			}
 
 			allocator_traits::deallocate(allocator, temp, _capacity);
@@ -0,0 +1,333 @@
+#ifndef BYTE_STATICHASHTREE_H
+#define BYTE_STATICHASHTREE_H
+
+#include "hash_tree_hash.h"
+
+#include <array>
+#include <optional>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <bit>
+#include <cstdint>
+
+namespace Byte
+{
+
+	template<typename K, typename T>
+	struct static_hash_tree_entry
+	{
+		K key;
+		T value;
+		std::optional<K> parent{};
+	};
+
+	template<
+		typename K,
+		typename T,
+		size_t N,
+		typename Hasher = static_hash<K>,
+		typename Keyeq = std::equal_to<K>>
+	class static_hash_tree
+	{
+	private:
+		inline static constexpr size_t EMPTY{ std::numeric_limits<size_t>::max() };
+		inline static constexpr size_t TABLE_SIZE{ std::bit_ceil(2 * N) };
+		inline static constexpr size_t BUCKET_COUNT{ std::bit_ceil(N / 2 + 1) };
+		inline static constexpr uint32_t MAX_DISPLACEMENT{ 1U << 16 };
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+		using entry_type = static_hash_tree_entry<K, T>;
+
+		using iterator = typename std::array<T, N>::const_iterator;
+		using const_iterator = typename std::array<T, N>::const_iterator;
+
+	private:
+		std::array<K, N> _keys{};
+		std::array<T, N> _values{};
+		std::array<size_t, N> _parents{};
+		std::array<size_t, N + 1> _child_offsets{};
+		std::array<size_t, N> _childs{};
+		std::array<uint32_t, BUCKET_COUNT> _displacements{};
+		std::array<size_t, TABLE_SIZE> _slots{};
+		Hasher _hasher;
+		Keyeq _keyeq;
+
+	public:
+		constexpr static_hash_tree(const std::array<entry_type, N>& entries, const Hasher& hasher = {}, const Keyeq& keyeq = {})
+			:_hasher{ hasher }, _keyeq{ keyeq }
+		{
+			std::array<size_t, N> positions{};
+			build_order(entries, positions);
+			build_childs();
+			build_slots();
+		}
+
+		constexpr const T& at(const K& key) const
+		{
+			return _values[index(key)];
+		}
+
+		constexpr const T& operator[](const K& key) const
+		{
+			return at(key);
+		}
+
+		constexpr bool contains(const K& key) const
+		{
+			return index(key) != EMPTY;
+		}
+
+		constexpr size_t child_count(const K& key) const
+		{
+			size_t position{ index(key) };
+			return _child_offsets[position + 1] - _child_offsets[position];
+		}
+
+		template<typename Function>
+		constexpr void for_each_child(const K& key, Function&& function) const
+		{
+			size_t position{ index(key) };
+			for (size_t i{ _child_offsets[position] }; i < _child_offsets[position + 1]; ++i)
+			{
+				function(_keys[_childs[i]], _values[_childs[i]]);
+			}
+		}
+
+		constexpr const_iterator begin() const
+		{
+			return _values.begin();
+		}
+
+		constexpr const_iterator end() const
+		{
+			return _values.end();
+		}
+
+		constexpr size_t size() const
+		{
+			return N;
+		}
+
+		constexpr bool empty() const
+		{
+			return N == 0;
+		}
+
+		constexpr size_t table_size() const
+		{
+			return TABLE_SIZE;
+		}
+
+	private:
+		constexpr size_t index(const K& key) const
+		{
+			if constexpr (N == 0)
+			{
+				return EMPTY;
+			}
+			else
+			{
+				size_t hash_value{ _hasher(key) };
+				uint32_t displacement{ _displacements[hash_value & (BUCKET_COUNT - 1)] };
+				size_t position{ _slots[_mix_hash(hash_value, displacement) & (TABLE_SIZE - 1)] };
+
+				if (position != EMPTY && _keyeq(_keys[position], key))
+				{
+					return position;
+				}
+
+				return EMPTY;
+			}
+		}
+
+		constexpr void build_order(const std::array<entry_type, N>& entries, std::array<size_t, N>& positions)
+		{
+			std::array<size_t, N> entry_parents{};
+			std::array<size_t, N + 1> offsets{};
+			std::array<size_t, N> childs{};
+
+			for (size_t i{ 0 }; i < N; ++i)
+			{
+				for (size_t j{ 0 }; j < i; ++j)
+				{
+					if (_keyeq(entries[j].key, entries[i].key))
+					{
+						throw std::invalid_argument{ "static_hash_tree: duplicate key" };
+					}
+				}
+
+				entry_parents[i] = i == 0 ? EMPTY : 0;
+				if (entries[i].parent)
+				{
+					size_t j{ 0 };
+					while (j < i && !_keyeq(entries[j].key, *entries[i].parent))
+					{
+						++j;
+					}
+
+					if (j == i)
+					{
+						throw std::invalid_argument{ "static_hash_tree: parent must precede its child" };
+					}
+					entry_parents[i] = j;
+				}
+
+				if (entry_parents[i] != EMPTY)
+				{
+					++offsets[entry_parents[i] + 1];
+				}
+			}
+
+			for (size_t i{ 0 }; i < N; ++i)
+			{
+				offsets[i + 1] += offsets[i];
+			}
+
+			std::array<size_t, N + 1> cursor{ offsets };
+			for (size_t i{ 0 }; i < N; ++i)
+			{
+				if (entry_parents[i] != EMPTY)
+				{
+					childs[cursor[entry_parents[i]]++] = i;
+				}
+			}
+
+			std::array<size_t, N> visit{};
+			size_t visit_size{ 0 };
+			size_t position{ 0 };
+			if (N != 0)
+			{
+				visit[visit_size++] = 0;
+			}
+
+			while (visit_size != 0)
+			{
+				size_t entry_index{ visit[--visit_size] };
+				positions[entry_index] = position;
+
+				_keys[position] = entries[entry_index].key;
+				_values[position] = entries[entry_index].value;
+				_parents[position] = entry_parents[entry_index] == EMPTY ? EMPTY : positions[entry_parents[entry_index]];
+
+				for (size_t i{ offsets[entry_index + 1] }; i > offsets[entry_index]; --i)
+				{
+					visit[visit_size++] = childs[i - 1];
+				}
+				++position;
+			}
+		}
+
+		constexpr void build_childs()
+		{
+			for (size_t position{ 0 }; position < N; ++position)
+			{
+				if (_parents[position] != EMPTY)
+				{
+					++_child_offsets[_parents[position] + 1];
+				}
+			}
+
+			for (size_t position{ 0 }; position < N; ++position)
+			{
+				_child_offsets[position + 1] += _child_offsets[position];
+			}
+
+			std::array<size_t, N + 1> cursor{ _child_offsets };
+			for (size_t position{ 0 }; position < N; ++position)
+			{
+				if (_parents[position] != EMPTY)
+				{
+					_childs[cursor[_parents[position]]++] = position;
+				}
+			}
+		}
+
+		constexpr void build_slots()
+		{
+			std::array<size_t, N> hashes{};
+			std::array<size_t, BUCKET_COUNT + 1> offsets{};
+			std::array<size_t, N> members{};
+
+			for (size_t position{ 0 }; position < N; ++position)
+			{
+				hashes[position] = _hasher(_keys[position]);
+				++offsets[(hashes[position] & (BUCKET_COUNT - 1)) + 1];
+			}
+
+			size_t max_bucket{ 0 };
+			for (size_t bucket{ 0 }; bucket < BUCKET_COUNT; ++bucket)
+			{
+				max_bucket = offsets[bucket + 1] > max_bucket ? offsets[bucket + 1] : max_bucket;
+				offsets[bucket + 1] += offsets[bucket];
+			}
+
+			std::array<size_t, BUCKET_COUNT + 1> cursor{ offsets };
+			for (size_t position{ 0 }; position < N; ++position)
+			{
+				members[cursor[hashes[position] & (BUCKET_COUNT - 1)]++] = position;
+			}
+
+			for (size_t& slot : _slots)
+			{
+				slot = EMPTY;
+			}
+
+			for (size_t bucket_size{ max_bucket }; bucket_size > 0; --bucket_size)
+			{
+				for (size_t bucket{ 0 }; bucket < BUCKET_COUNT; ++bucket)
+				{
+					if (offsets[bucket + 1] - offsets[bucket] == bucket_size)
+					{
+						place(bucket, offsets[bucket], offsets[bucket + 1], hashes, members);
+					}
+				}
+			}
+		}
+
+		constexpr void place(
+			size_t bucket,
+			size_t first,
+			size_t last,
+			const std::array<size_t, N>& hashes,
+			const std::array<size_t, N>& members)
+		{
+			for (uint32_t displacement{ 0 }; displacement < MAX_DISPLACEMENT; ++displacement)
+			{
+				size_t placed{ first };
+				for (; placed < last; ++placed)
+				{
+					size_t slot{ _mix_hash(hashes[members[placed]], displacement) & (TABLE_SIZE - 1) };
+					if (_slots[slot] != EMPTY)
+					{
+						break;
+					}
+					_slots[slot] = members[placed];
+				}
+
+				if (placed == last)
+				{
+					_displacements[bucket] = displacement;
+					return;
+				}
+
+				for (size_t i{ first }; i < placed; ++i)
+				{
+					_slots[_mix_hash(hashes[members[i]], displacement) & (TABLE_SIZE - 1)] = EMPTY;
+				}
+			}
+
+			throw std::invalid_argument{ "static_hash_tree: no perfect hash found" };
+		}
+	};
+
+	template<typename K, typename T, size_t N>
+	static_hash_tree(const std::array<static_hash_tree_entry<K, T>, N>&) -> static_hash_tree<K, T, N>;
+
+}
+
+#endif
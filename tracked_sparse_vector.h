@@ -0,0 +1,243 @@
+#ifndef BYTE_TRACKEDSPARSEVECTOR_H
+#define BYTE_TRACKEDSPARSEVECTOR_H
+
+#include "sparse_vector.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	template<typename T, typename Allocator = std::allocator<T>>
+	class tracked_sparse_vector
+	{
+	private:
+		using base_type = sparse_vector<T, Allocator>;
+
+	public:
+		using value_type = typename base_type::value_type;
+		using allocator_type = typename base_type::allocator_type;
+		using pointer = typename base_type::pointer;
+		using const_pointer = typename base_type::const_pointer;
+		using reference = typename base_type::reference;
+		using const_reference = typename base_type::const_reference;
+		using size_type = typename base_type::size_type;
+		using difference_type = typename base_type::difference_type;
+		using iterator = typename base_type::iterator;
+		using const_iterator = typename base_type::const_iterator;
+
+	private:
+		base_type _data;
+		std::vector<bool> _dirty;
+
+	public:
+		tracked_sparse_vector(size_t initial_capacity = _BITSET_SIZE)
+			:_data{ initial_capacity }, _dirty(_data.capacity() / _BITSET_SIZE, false)
+		{
+		}
+
+		template<class... Args>
+		[[maybe_unused]] size_t emplace(Args&&... args)
+		{
+			size_t index{ _data.emplace(std::forward<Args>(args)...) };
+			mark(index);
+
+			return index;
+		}
+
+		void insert(size_t index, const T& value)
+		{
+			insert(index, T{ value });
+		}
+
+		void insert(size_t index, T&& value)
+		{
+			_data.insert(index, std::move(value));
+			mark(index);
+		}
+
+		void erase(size_t index)
+		{
+			_data.erase(index);
+			mark(index);
+		}
+
+		reference at(size_t index)
+		{
+			mark(index);
+			return _data.at(index);
+		}
+
+		const_reference at(size_t index) const
+		{
+			return _data.at(index);
+		}
+
+		reference operator[](size_t index)
+		{
+			return at(index);
+		}
+
+		const_reference operator[](size_t index) const
+		{
+			return at(index);
+		}
+
+		size_t size() const
+		{
+			return _data.size();
+		}
+
+		bool empty() const
+		{
+			return _data.empty();
+		}
+
+		size_t capacity() const
+		{
+			return _data.capacity();
+		}
+
+		void clear()
+		{
+			_data.clear();
+			_dirty.assign(block_count(), true);
+		}
+
+		iterator begin()
+		{
+			std::fill(_dirty.begin(), _dirty.end(), true);
+			return _data.begin();
+		}
+
+		iterator end()
+		{
+			return _data.end();
+		}
+
+		const_iterator begin() const
+		{
+			return _data.begin();
+		}
+
+		const_iterator end() const
+		{
+			return _data.end();
+		}
+
+		void reserve(size_t new_capacity)
+		{
+			_data.reserve(new_capacity);
+			_dirty.resize(block_count(), false);
+		}
+
+		void shrink_to_fit()
+		{
+			_data.shrink_to_fit();
+			_dirty.resize(block_count(), false);
+		}
+
+		bool test(size_t index) const
+		{
+			return _data.test(index);
+		}
+
+		size_t block_count() const
+		{
+			return _data.capacity() / _BITSET_SIZE;
+		}
+
+		bool dirty(size_t block_index) const
+		{
+			return _dirty[block_index];
+		}
+
+		void clean()
+		{
+			_dirty.assign(block_count(), false);
+		}
+
+	private:
+		void mark(size_t index)
+		{
+			size_t block_index{ index / _BITSET_SIZE };
+			if (block_index >= _dirty.size())
+			{
+				_dirty.resize(block_count(), false);
+			}
+			_dirty[block_index] = true;
+		}
+	};
+
+	template<typename T, size_t RangeSize = 512>
+	class tracked_vector
+	{
+	public:
+		using value_type = T;
+		using reference = T&;
+		using const_reference = const T&;
+
+		inline static constexpr size_t RANGE_SIZE{ RangeSize };
+
+	private:
+		std::vector<T> _data;
+		std::vector<bool> _dirty;
+
+	public:
+		tracked_vector() = default;
+
+		tracked_vector(size_t count, const T& value)
+		{
+			assign(count, value);
+		}
+
+		void assign(size_t count, const T& value)
+		{
+			_data.assign(count, value);
+			_dirty.assign(range_count(), true);
+		}
+
+		void shrink_to_fit()
+		{
+			_data.shrink_to_fit();
+			_dirty.shrink_to_fit();
+		}
+
+		reference operator[](size_t index)
+		{
+			_dirty[index / RangeSize] = true;
+			return _data[index];
+		}
+
+		const_reference operator[](size_t index) const
+		{
+			return _data[index];
+		}
+
+		size_t size() const
+		{
+			return _data.size();
+		}
+
+		size_t range_count() const
+		{
+			return (_data.size() + RangeSize - 1) / RangeSize;
+		}
+
+		bool dirty(size_t range_index) const
+		{
+			return _dirty[range_index];
+		}
+
+		void clean()
+		{
+			_dirty.assign(range_count(), false);
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,437 @@
+#ifndef BYTE_TTLHASHTREE_H
+#define BYTE_TTLHASHTREE_H
+
+#include "hash_tree.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Byte
+{
+
+	template<
+		typename K,
+		typename T,
+		typename Hasher = default_hash<K>,
+		typename Keyeq = std::equal_to<K>,
+		typename Index = size_t,
+		typename Clock = std::chrono::steady_clock>
+	class ttl_hash_tree
+	{
+	private:
+		using tree_type = hash_tree<K, T, Hasher, Keyeq, Index>;
+
+		inline static constexpr size_t WHEEL_BITS{ 6 };
+		inline static constexpr size_t WHEEL_SIZE{ 1ULL << WHEEL_BITS };
+		inline static constexpr size_t WHEEL_LEVELS{ 4 };
+		inline static constexpr uint64_t WHEEL_SPAN{ 1ULL << (WHEEL_BITS * WHEEL_LEVELS) };
+		inline static constexpr uint64_t PERSISTENT{ 0 };
+
+		struct timer
+		{
+			Index node_index;
+			uint64_t expiry;
+		};
+
+		using slot_type = std::vector<timer>;
+		using wheel_type = std::array<std::array<slot_type, WHEEL_SIZE>, WHEEL_LEVELS>;
+
+	public:
+		using hasher = Hasher;
+		using key_type = K;
+		using mapped_type = T;
+		using key_equal = Keyeq;
+		using value_type = std::pair<const K, T>;
+		using clock_type = Clock;
+		using duration = typename Clock::duration;
+		using time_point = typename Clock::time_point;
+		using const_iterator = typename tree_type::const_iterator;
+		using expire_callback = std::function<void(const K&, T&)>;
+
+	private:
+		tree_type _tree;
+		std::vector<uint64_t> _expiry;
+		wheel_type _wheel;
+		std::array<uint64_t, WHEEL_LEVELS> _occupied{};
+		slot_type _due;
+		size_t _scheduled{ 0 };
+		uint64_t _current{ 0 };
+		time_point _epoch{ Clock::now() };
+		duration _resolution;
+		size_t _sweep_limit;
+		expire_callback _on_expire;
+
+	public:
+		explicit ttl_hash_tree(duration resolution = std::chrono::milliseconds{ 1 }, size_t sweep_limit = 64)
+			:_resolution{ resolution }, _sweep_limit{ sweep_limit }
+		{
+		}
+
+		void insert(const K& key, const T& value)
+		{
+			insert(key, T{ value });
+		}
+
+		void insert(const K& key, T&& value)
+		{
+			uint64_t now{ tick(_sweep_limit) };
+			schedule(store(key, std::move(value)), PERSISTENT, now);
+		}
+
+		void insert(const K& key, const T& value, const K& parent)
+		{
+			insert(key, T{ value }, parent);
+		}
+
+		void insert(const K& key, T&& value, const K& parent)
+		{
+			uint64_t now{ tick(_sweep_limit) };
+			schedule(store(key, std::move(value), parent), PERSISTENT, now);
+		}
+
+		void insert_for(const K& key, T value, duration ttl)
+		{
+			uint64_t now{ tick(_sweep_limit) };
+			schedule(store(key, std::move(value)), expiry_of(Clock::now() + ttl), now);
+		}
+
+		void insert_for(const K& key, T value, const K& parent, duration ttl)
+		{
+			uint64_t now{ tick(_sweep_limit) };
+			schedule(store(key, std::move(value), parent), expiry_of(Clock::now() + ttl), now);
+		}
+
+		void expire_at(const K& key, time_point deadline)
+		{
+			uint64_t now{ tick(_sweep_limit) };
+			schedule(_tree.index(key), expiry_of(deadline), now);
+		}
+
+		void expire_after(const K& key, duration ttl)
+		{
+			expire_at(key, Clock::now() + ttl);
+		}
+
+		void persist(const K& key)
+		{
+			_expiry[_tree.index(key)] = PERSISTENT;
+		}
+
+		void erase(const K& key)
+		{
+			tick(_sweep_limit);
+			Index node_index{ _tree.index(key) };
+			if (node_index != tree_type::_EMPTY_INDEX)
+			{
+				erase_index(node_index);
+			}
+		}
+
+		void set_parent(const K& key, const K& new_parent)
+		{
+			tick(_sweep_limit);
+			_tree.set_parent(key, new_parent);
+		}
+
+		void set_parent(const K& key, const K& new_parent, size_t position)
+		{
+			tick(_sweep_limit);
+			_tree.set_parent(key, new_parent, position);
+		}
+
+		T* find(const K& key)
+		{
+			uint64_t now{ tick(_sweep_limit) };
+			Index _index{ _tree.index(key) };
+			if (_index == tree_type::_EMPTY_INDEX || expired(_index, now))
+			{
+				return nullptr;
+			}
+
+			return &_tree._nodes[_index].pair.second;
+		}
+
+		T& at(const K& key)
+		{
+			return *find(key);
+		}
+
+		bool contains(const K& key)
+		{
+			return find(key) != nullptr;
+		}
+
+		size_t tick()
+		{
+			return expire(advance(), std::numeric_limits<size_t>::max());
+		}
+
+		const_iterator begin() const
+		{
+			return std::as_const(_tree).begin();
+		}
+
+		const_iterator end() const
+		{
+			return std::as_const(_tree).end();
+		}
+
+		size_t size() const
+		{
+			return _tree.size();
+		}
+
+		void on_expire(expire_callback callback)
+		{
+			_on_expire = std::move(callback);
+		}
+
+		void clear()
+		{
+			_tree.clear();
+			_expiry.clear();
+			_due.clear();
+			for (auto& level : _wheel)
+			{
+				for (slot_type& slot : level)
+				{
+					slot.clear();
+				}
+			}
+			_occupied.fill(0);
+			_scheduled = 0;
+		}
+
+		const tree_type& tree() const
+		{
+			return _tree;
+		}
+
+	private:
+		Index store(const K& key, T&& value)
+		{
+			Index node_index{ _tree.index(key) };
+			if (node_index == tree_type::_EMPTY_INDEX)
+			{
+				_tree.insert(key, std::move(value));
+				return _tree.index(key);
+			}
+
+			_tree._nodes[node_index].pair.second = std::move(value);
+			return node_index;
+		}
+
+		Index store(const K& key, T&& value, const K& parent)
+		{
+			Index node_index{ _tree.index(key) };
+			if (node_index == tree_type::_EMPTY_INDEX)
+			{
+				_tree.insert(key, std::move(value), parent);
+				return _tree.index(key);
+			}
+
+			_tree._nodes[node_index].pair.second = std::move(value);
+			return node_index;
+		}
+
+		uint64_t tick(size_t limit)
+		{
+			uint64_t now{ advance() };
+			expire(now, limit);
+			return now;
+		}
+
+		uint64_t expiry_of(time_point deadline) const
+		{
+			if (deadline <= _epoch)
+			{
+				return 1;
+			}
+
+			duration elapsed{ deadline - _epoch };
+			return static_cast<uint64_t>((elapsed + _resolution - duration{ 1 }) / _resolution) + 1;
+		}
+
+		uint64_t now_tick() const
+		{
+			return static_cast<uint64_t>((Clock::now() - _epoch) / _resolution) + 1;
+		}
+
+		bool expired(Index node_index, uint64_t now) const
+		{
+			for (; node_index != tree_type::_EMPTY_INDEX; node_index = std::as_const(_tree._nodes)[node_index].parent_index)
+			{
+				uint64_t expiry{ _expiry[node_index] };
+				if (expiry != PERSISTENT && expiry <= now)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void schedule(Index node_index, uint64_t expiry, uint64_t now)
+		{
+			if (node_index >= _expiry.size())
+			{
+				_expiry.resize(_tree._nodes.capacity(), PERSISTENT);
+			}
+
+			_expiry[node_index] = expiry;
+			if (expiry != PERSISTENT)
+			{
+				place(timer{ node_index, expiry }, now);
+			}
+		}
+
+		void place(const timer& entry, uint64_t now)
+		{
+			if (entry.expiry <= _current || entry.expiry <= now)
+			{
+				_due.push_back(entry);
+				return;
+			}
+
+			uint64_t delta{ entry.expiry - _current };
+			uint64_t expiry{ delta < WHEEL_SPAN ? entry.expiry : _current + WHEEL_SPAN - 1 };
+
+			size_t level{ 0 };
+			while (level + 1 < WHEEL_LEVELS && delta >= 1ULL << (WHEEL_BITS * (level + 1)))
+			{
+				++level;
+			}
+
+			size_t slot{ (expiry >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1) };
+			_wheel[level][slot].push_back(entry);
+			_occupied[level] |= 1ULL << slot;
+			++_scheduled;
+		}
+
+		uint64_t advance()
+		{
+			uint64_t now{ now_tick() };
+			while (_current < now)
+			{
+				uint64_t next{ _scheduled == 0 ? now + 1 : next_tick() };
+				if (next > now)
+				{
+					_current = now;
+					break;
+				}
+
+				_current = next;
+				for (size_t level{ 1 }; level < WHEEL_LEVELS; ++level)
+				{
+					if (_current & ((1ULL << (WHEEL_BITS * level)) - 1))
+					{
+						break;
+					}
+
+					size_t index{ (_current >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1) };
+					slot_type cascade;
+					cascade.swap(_wheel[level][index]);
+					_occupied[level] &= ~(1ULL << index);
+					_scheduled -= cascade.size();
+					for (const timer& entry : cascade)
+					{
+						place(entry, _current);
+					}
+				}
+
+				size_t index{ _current & (WHEEL_SIZE - 1) };
+				slot_type& slot{ _wheel[0][index] };
+				_occupied[0] &= ~(1ULL << index);
+				_scheduled -= slot.size();
+				_due.insert(_due.end(), slot.begin(), slot.end());
+				slot.clear();
+			}
+
+			return now;
+		}
+
+		uint64_t next_tick() const
+		{
+			uint64_t next{ std::numeric_limits<uint64_t>::max() };
+			for (size_t level{ 0 }; level < WHEEL_LEVELS; ++level)
+			{
+				if (_occupied[level] == 0)
+				{
+					continue;
+				}
+
+				size_t shift{ WHEEL_BITS * level };
+				uint64_t block{ _current >> shift };
+				size_t slot{ block & (WHEEL_SIZE - 1) };
+				uint64_t ahead{ slot + 1 < WHEEL_SIZE ? _occupied[level] & (~0ULL << (slot + 1)) : 0 };
+				uint64_t target{ ahead
+					? block - slot + std::countr_zero(ahead)
+					: block - slot + WHEEL_SIZE + std::countr_zero(_occupied[level]) };
+				next = std::min(next, target << shift);
+			}
+
+			return next;
+		}
+
+		size_t expire(uint64_t now, size_t limit)
+		{
+			size_t count{ 0 };
+			while (!_due.empty() && count < limit)
+			{
+				timer entry{ _due.back() };
+				_due.pop_back();
+
+				if (entry.node_index >= _expiry.size()
+					|| _expiry[entry.node_index] != entry.expiry
+					|| entry.expiry > now
+					|| !_tree._nodes.test(entry.node_index))
+				{
+					continue;
+				}
+
+				auto& node{ _tree._nodes[entry.node_index] };
+				if (_on_expire)
+				{
+					_on_expire(node.pair.first, node.pair.second);
+				}
+
+				erase_index(entry.node_index);
+				++count;
+			}
+
+			return count;
+		}
+
+		void erase_index(Index node_index)
+		{
+			std::vector<Index> visit{ node_index };
+			for (size_t i{ 0 }; i < visit.size(); ++i)
+			{
+				if (visit[i] < _expiry.size())
+				{
+					_expiry[visit[i]] = PERSISTENT;
+				}
+
+				for (Index child_index : std::as_const(_tree._nodes)[visit[i]].childs)
+				{
+					if (child_index != tree_type::_EMPTY_INDEX)
+					{
+						visit.push_back(child_index);
+					}
+				}
+			}
+
+			_tree._erase(node_index);
+		}
+	};
+
+}
+
+#endif